@@ -0,0 +1,72 @@
+// Sweeps the escape-check unroll factor K of the CPU kernel over the
+// standard views and checks every variant against K = 1.
+//
+//   bench_unroll [width height]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/mandel.h"
+
+#define DEFAULT_WIDTH 400
+#define DEFAULT_HEIGHT 343
+#define REPEATS 3
+
+static double renderSeconds(const MandelView* view, int width, int height,
+                            MandelIterateFn iterate, int* iterOut) {
+    double best = 0.0;
+    for (int r = 0; r < REPEATS; r++) {
+        clock_t start = clock();
+        mandelRenderRegion(view, width, height, 0, 0, width, height, iterate, iterOut);
+        double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+        if (r == 0 || elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    int width = DEFAULT_WIDTH;
+    int height = DEFAULT_HEIGHT;
+    if (argc == 3) {
+        width = atoi(argv[1]);
+        height = atoi(argv[2]);
+    }
+    if (width <= 0 || height <= 0) {
+        fprintf(stderr, "usage: bench_unroll [width height]\n");
+        return -1;
+    }
+
+    size_t pixels = (size_t)width * height;
+    int* reference = malloc(pixels * sizeof(int));
+    int* iters = malloc(pixels * sizeof(int));
+    if (!reference || !iters) {
+        fprintf(stderr, "Failed to allocate %zu pixels\n", pixels);
+        return -1;
+    }
+
+    printf("%dx%d, best of %d\n", width, height, REPEATS);
+    printf("%-10s %4s %10s %9s %8s\n", "view", "K", "ms", "speedup", "diffs");
+    int failed = 0;
+    for (int v = 0; v < MANDEL_STANDARD_VIEW_COUNT; v++) {
+        const MandelView* view = &MANDEL_STANDARD_VIEWS[v];
+        double base = renderSeconds(view, width, height, mandelGetIterate(1), reference);
+
+        for (int k = 0; k < MANDEL_UNROLL_COUNT; k++) {
+            int unroll = MANDEL_UNROLLS[k];
+            double t = renderSeconds(view, width, height, mandelGetIterate(unroll), iters);
+            size_t diffs = 0;
+            for (size_t p = 0; p < pixels; p++) {
+                if (iters[p] != reference[p]) diffs++;
+            }
+            if (diffs) failed = 1;
+            printf("%-10s %4d %10.2f %8.2fx %8zu\n", view->name, unroll, t*1000.0,
+                   t > 0.0 ? base/t : 0.0, diffs);
+        }
+    }
+
+    free(reference);
+    free(iters);
+    return failed;
+}
@@ -2,27 +2,73 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
-#include <windows.h>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
-#define VERTEX_SHADER_PATH "shader/vertex_shader.glsl"
-#define FRAG_SHADER_PATH "shader/fragment_shader.glsl"
-#define COMPUTE_SHADER_PATH "shader/compute_shader.glsl"
+#include "src/shader_variant.h"
+#include "src/autotune.h"
+#include "src/render_target.h"
+#include "src/gpu_bench.h"
+#include "src/present.h"
+#include "src/profiler.h"
+#include "src/trace.h"
+#include "src/frame_histogram.h"
+#include "src/platform.h"
+#include "src/capture.h"
+#include "src/image_io.h"
+#include "src/program_cache.h"
+#include "src/parallel_compile.h"
+#include "src/shader_source.h"
+#include "src/hot_reload.h"
+#include "src/zoom_history.h"
+#include "src/prefetch.h"
+#include "src/zoom_animator.h"
+
+#define VERTEX_SHADER_NAME "vertex_shader.glsl"
+#define FRAG_SHADER_NAME "fragment_shader.glsl"
+#define COMPUTE_SHADER_NAME "compute_shader.glsl"
+#define FRAME_TIMES_PATH "frametimes.json"
+// F12 writes screenshot00000.png, screenshot00001.png, ...
+#define SCREENSHOT_PATTERN "screenshot.png"
+// cleared into a target while no variant for it has linked yet
+#define PLACEHOLDER_GREY 0.1f
+// how long a converged view sleeps between checks when no event arrives
+#define IDLE_WAIT_SECONDS 0.5
+// and how often it looks again while views are being prefetched
+#define PREFETCH_POLL_SECONDS 0.005
+// a release closer than this to the press (window UVs) is a click, not a box
+#define CLICK_SLOP 0.005
 
 const int SCREEN_WIDTH = 1000;
 const int SCREEN_HEIGHT = 857;
 
-double time = 0.0;
+int fbWidth = 1000;
+int fbHeight = 857;
+
+double current_time = 0.0;
 double last_time = 0.0;
-long frameCount = 0;
-float avgFPS = 0;
+// wheel notches since the loop last looked, up is positive
+double scroll_steps = 0.0;
 
 typedef struct {
     double x;
     double y;
 } vec2;
 
+// everything the rendered image depends on, compared with memcmp
+typedef struct {
+    vec2 A;
+    vec2 B;
+    vec2 C;
+    vec2 mouse;
+    double depth;
+    int colour;
+    int output;
+    int overlay;
+    int renderWidth;
+    int renderHeight;
+} ViewState;
+
 typedef struct {
     const float* vertices;
     size_t vertexSize;
@@ -44,24 +90,12 @@ typedef struct {
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
+    fbWidth = width;
+    fbHeight = height;
 }
 
-char* get_shader_content(const char* fileName) {
-    FILE *fp = fopen(fileName, "rb");
-    if (!fp) return NULL;
-
-    if (fseek(fp, 0, SEEK_END) != 0) { fclose(fp); return NULL; }
-    long size = ftell(fp);
-    if (size < 0) { fclose(fp); return NULL; }
-    rewind(fp);
-
-    char* shaderContent = malloc((size_t)size + 1);
-    if (!shaderContent) { fclose(fp); return NULL; }
-
-    size_t read = fread(shaderContent, 1, (size_t)size, fp);
-    shaderContent[read] = '\0';
-    fclose(fp);
-    return shaderContent;
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
+    scroll_steps += yoffset;
 }
 
 GLuint createShader(const char* vertexShaderSource, const char* fragmentShaderSource) {
@@ -76,6 +110,7 @@ GLuint createShader(const char* vertexShaderSource, const char* fragmentShaderSo
     GLuint program = glCreateProgram();
     glAttachShader(program, vertexShader);
     glAttachShader(program, fragmentShader);
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(program);
 
     glDetachShader(program, vertexShader);
@@ -86,6 +121,84 @@ GLuint createShader(const char* vertexShaderSource, const char* fragmentShaderSo
     return program;
 }
 
+// grows *buffer to at least bytes, returns 0 if that fails
+int reserveBytes(unsigned char** buffer, size_t* capacity, size_t bytes) {
+    if (bytes <= *capacity) return 1;
+    unsigned char* grown = realloc(*buffer, bytes);
+    if (!grown) return 0;
+    *buffer = grown;
+    *capacity = bytes;
+    return 1;
+}
+
+void stateSection(const ViewState* s, double section[4]) {
+    section[0] = s->A.x;
+    section[1] = s->A.y;
+    section[2] = s->B.x;
+    section[3] = s->B.y;
+}
+
+// the state without its section, what a prefetched view must match besides it
+ViewState prefetchKey(const ViewState* s) {
+    ViewState key = *s;
+    key.A = (vec2){0,0};
+    key.B = (vec2){0,0};
+    return key;
+}
+
+// the uniforms every variant takes, for the program in use
+void setViewUniforms(const KernelVariant* variant, const ViewState* s, vec2 mouse) {
+    glUniform1f(0, s->depth);
+    setSectionUniform(variant, s->A.x,s->A.y,s->B.x,s->B.y);
+    glUniform4f(2,s->C.x,s->C.y,mouse.x,mouse.y);
+    glUniform2i(3, s->renderWidth, s->renderHeight);
+}
+
+// copies a frame rendered in full to where animated frames reuse it from
+void copyReference(TargetPool* pool, RenderTarget* reference, const RenderTarget* frame) {
+    fitTarget(pool, reference, frame->width, frame->height, frame->format);
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+    glCopyImageSubData(frame->texture, GL_TEXTURE_2D, 0, 0, 0, 0,
+                       reference->texture, GL_TEXTURE_2D, 0, 0, 0, 0, frame->width, frame->height, 1);
+}
+
+// presents the finished frame to the window and captures it for --capture
+// and the screenshot key
+void presentFinished(Presenter* presenter, FrameCapture* capture, const RenderTarget* finished,
+                     const char* capturePattern, unsigned long long* captureFrame,
+                     int screenshot, unsigned long long* screenshotCount) {
+    presentTarget(presenter, finished, 0, fbWidth, fbHeight);
+    char capturePath[CAPTURE_PATH_MAX];
+    if (capturePattern) {
+        formatFramePath(capturePath, sizeof(capturePath), capturePattern, (*captureFrame)++);
+        captureTarget(capture, finished, capturePath);
+    }
+    if (screenshot) {
+        formatFramePath(capturePath, sizeof(capturePath), SCREENSHOT_PATTERN, (*screenshotCount)++);
+        if (captureTarget(capture, finished, capturePath)) printf("screenshot %s\n", capturePath);
+    }
+}
+
+// picks the kernel for the view, falling back to float without fp64
+VariantStatus requestViewProgram(VariantCache* variants, WorkgroupSize workgroup, const ViewState* s,
+                                 KernelVariant* variant, GLuint* program) {
+    double left = fmin(s->A.x,s->B.x)*3.5 - 2.5;
+    double right = fmax(s->A.x,s->B.x)*3.5 - 2.5;
+    double bottom = fmin(s->A.y,s->B.y)*3.0 - 1.5;
+    double top = fmax(s->A.y,s->B.y)*3.0 - 1.5;
+    *variant = chooseVariant(left, bottom, right, top, (right-left)/s->renderWidth,
+                             s->depth, s->colour, s->output);
+    variant->localX = workgroup.x;
+    variant->localY = workgroup.y;
+    VariantStatus status = requestVariantProgram(variants, variant, program);
+    if (status == VARIANT_FAILED && variant->precision == PRECISION_DOUBLE) {
+        // no fp64 support, render with float rather than nothing
+        variant->precision = PRECISION_FLOAT;
+        status = requestVariantProgram(variants, variant, program);
+    }
+    return status;
+}
+
 void bindBuffers(MeshBuffers* mbuf, MeshData* data) {
     glBindVertexArray(mbuf->vao);
     
@@ -130,17 +243,8 @@ void drawMesh(MeshBuffers* mbuf, MeshMaterial* mMat) {
 
 }
 
-void CalcFPS() {
-    frameCount++;
-    last_time = time;
-    time = glfwGetTime();
-    double delta = time-last_time;
-    int fps = 1/delta;
-    avgFPS =(((float)frameCount-1)/(float)frameCount)*avgFPS + fps/(float)frameCount;
-    //printf("FPS: %d\n",fps);
-}
-
-int main(void) {
+int main(int argc, char** argv) {
+    double startTime = platformTime();
     if(!glfwInit()) {
         fprintf(stderr,"Failed to initialize glfw");
         return -1;
@@ -164,9 +268,18 @@ int main(void) {
         glfwTerminate();
         return -1;
     }
+    // before the first compile so that every program goes to the driver's threads
+    if (!initParallelCompile((GLADloadproc)glfwGetProcAddress)) {
+        printf("no parallel shader compile, variants compile on first use\n");
+    }
 
-    glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+    glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+    glViewport(0, 0, fbWidth, fbHeight);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+    // input is read by polling, sticky state keeps taps that start and end during an idle wait
+    glfwSetInputMode(window, GLFW_STICKY_KEYS, GLFW_TRUE);
+    glfwSetInputMode(window, GLFW_STICKY_MOUSE_BUTTONS, GLFW_TRUE);
 
     float vertices[] = {
     // positions           //UVs
@@ -181,99 +294,659 @@ int main(void) {
         1,2,3   //second triangle
     };
 
-    const char* vertexShaderSource = get_shader_content(VERTEX_SHADER_PATH);
-    const char* fragmentShaderSource = get_shader_content(FRAG_SHADER_PATH);
+    // render targets follow the framebuffer size times renderScale
+    float renderScale = 1.0f;
+    OutputFormat output = OUTPUT_RGBA8;
+    PresentMode presentMode = PRESENT_BLIT;
+    int ringSize = 2;
+    int forceAutotune = 0;
+    int benchFormats = 0;
+    int benchRing = 0;
+    int showOverlay = 0;
+    double budgetMs = 1000.0/60.0;
+    double maxDepth = 10000.0;
+    double targetFps = 0.0;
+    const char* capturePattern = NULL;
+    int useProgramCache = 1;
+    int usePrefetch = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--autotune") == 0) {
+            forceAutotune = 1;
+        } else if (strcmp(argv[i], "--bench-formats") == 0) {
+            benchFormats = 1;
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            traceEnable();
+            traceThreadName("main");
+        } else if (strcmp(argv[i], "--depth") == 0 && i+1 < argc) {
+            maxDepth = atof(argv[++i]);
+            if (maxDepth < 1.0) maxDepth = 1.0;
+        } else if (strcmp(argv[i], "--fps") == 0 && i+1 < argc) {
+            targetFps = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--capture") == 0 && i+1 < argc) {
+            capturePattern = argv[++i];
+        } else if (strcmp(argv[i], "--shader-dir") == 0 && i+1 < argc) {
+            // dev mode, sources are read from disk instead of the embedded copies
+            setShaderDirectory(argv[++i]);
+        } else if (strcmp(argv[i], "--no-program-cache") == 0) {
+            useProgramCache = 0;
+        } else if (strcmp(argv[i], "--no-prefetch") == 0) {
+            usePrefetch = 0;
+        } else if (strcmp(argv[i], "--overlay") == 0) {
+            showOverlay = 1;
+        } else if (strcmp(argv[i], "--budget") == 0 && i+1 < argc) {
+            budgetMs = atof(argv[++i]);
+            if (budgetMs <= 0.0) budgetMs = 1000.0/60.0;
+        } else if (strcmp(argv[i], "--bench-ring") == 0) {
+            benchRing = 1;
+        } else if (strcmp(argv[i], "--ring") == 0 && i+1 < argc) {
+            ringSize = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--scale") == 0 && i+1 < argc) {
+            renderScale = (float)atof(argv[++i]);
+            if (renderScale <= 0.0f || renderScale > 1.0f) renderScale = 1.0f;
+        } else if (strcmp(argv[i], "--present-quad") == 0) {
+            presentMode = PRESENT_QUAD;
+        } else if (strcmp(argv[i], "--format") == 0 && i+1 < argc) {
+            if (!parseOutputFormat(argv[++i], &output)) {
+                fprintf(stderr, "Unknown format %s, using %s\n", argv[i], outputLayoutName(output));
+            }
+        }
+    }
+    const char* vertexShaderSource = loadShaderSource(VERTEX_SHADER_NAME);
+    const char* fragmentShaderSource = loadShaderSource(FRAG_SHADER_NAME);
     if (!vertexShaderSource || !fragmentShaderSource) {
-    fprintf(stderr, "Failed to load shader files\n");
+        fprintf(stderr, "Failed to load shader files\n");
         if (vertexShaderSource) free((void*)vertexShaderSource);
         if (fragmentShaderSource) free((void*)fragmentShaderSource);
         return -1;
     }
 
-    GLuint screenTexture;
-    glCreateTextures(GL_TEXTURE_2D, 1, &screenTexture);
-    glTextureParameteri(screenTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTextureParameteri(screenTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTextureParameteri(screenTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTextureParameteri(screenTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTextureStorage2D(screenTexture, 1, GL_RGBA32F, SCREEN_WIDTH, SCREEN_HEIGHT);
-	glBindImageTexture(0, screenTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
-
-    GLuint screenShaderProgram = createShader(vertexShaderSource,fragmentShaderSource);
+    // frame N+1 is computed while frame N is presented, one frame of latency
+    TargetPool targetPool;
+    initTargetPool(&targetPool);
+    RenderRing ring;
+    initRenderRing(&ring, &targetPool, ringSize, SCREEN_WIDTH, SCREEN_HEIGHT,
+                   outputInternalFormat(output));
+	glBindImageTexture(0, ring.targets[0].texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, ring.targets[0].format);
+
+    // linked programs are cached on disk, a warm start skips every compile
+    ProgramCache programCache;
+    initProgramCache(&programCache, PROGRAM_CACHE_DIR);
+    if (!useProgramCache) programCache.enabled = 0;
+    const char* screenSources[2] = {vertexShaderSource, fragmentShaderSource};
+    unsigned long long screenKey = programCacheKey(&programCache, screenSources, 2);
+    GLuint screenShaderProgram = loadCachedProgram(&programCache, screenKey);
+    if (!screenShaderProgram) {
+        double compileStart = platformTime();
+        screenShaderProgram = createShader(vertexShaderSource,fragmentShaderSource);
+        programCache.compileMs += (platformTime() - compileStart) * 1000.0;
+        storeCachedProgram(&programCache, screenKey, screenShaderProgram);
+    }
 
     MeshData quad = {vertices, sizeof(vertices), indices, sizeof(indices)};
     MeshBuffers quadbuf = CreateGPUMesh(&quad);
+    Presenter presenter;
+    initPresenter(&presenter, presentMode, screenShaderProgram, quadbuf.vao);
 
-    //setup compute shader
-    const char* computeShaderSource = get_shader_content(COMPUTE_SHADER_PATH);
-
-    GLuint computeShader = glCreateShader(GL_COMPUTE_SHADER);
-    glShaderSource(computeShader, 1, &computeShaderSource, NULL);
-    glCompileShader(computeShader);
-
-    GLuint computeProgram = glCreateProgram();
-    glAttachShader(computeProgram, computeShader);
-    glLinkProgram(computeProgram);
-
-    glDetachShader(computeProgram, computeShader);
-    glDeleteShader(computeShader);
+    //setup compute shader, variants are compiled on first use
+    const char* computeShaderSource = loadShaderSource(COMPUTE_SHADER_NAME);
+    if (!computeShaderSource) {
+        fprintf(stderr, "Failed to load shader files\n");
+        return -1;
+    }
+    VariantCache variants;
+    initVariantCache(&variants, computeShaderSource);
+    variants.binaries = &programCache;
+    ColourMode colour = COLOUR_PALETTE;
+
+    // workgroup size is tuned once per GPU and reused on later startups
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    WorkgroupSize workgroup;
+    if (forceAutotune || !loadWorkgroupSize(AUTOTUNE_PATH, renderer, &workgroup)) {
+        workgroup = autotuneWorkgroup(&variants, SCREEN_WIDTH, SCREEN_HEIGHT, output);
+        printf("workgroup size for %s: %dx%d\n", renderer, workgroup.x, workgroup.y);
+        if (!saveWorkgroupSize(AUTOTUNE_PATH, renderer, workgroup)) {
+            fprintf(stderr, "Failed to save %s\n", AUTOTUNE_PATH);
+        }
+    }
+    if (benchFormats) {
+        benchOutputFormats(&variants, screenShaderProgram, quadbuf.vao, 3840, 2160);
+        glViewport(0, 0, fbWidth, fbHeight);
+        glfwSetWindowShouldClose(window, 1);
+    }
+    if (benchRing) {
+        benchRenderRing(&variants, &presenter, workgroup.x, workgroup.y, fbWidth, fbHeight);
+        glfwSetWindowShouldClose(window, 1);
+    }
+    prewarmVariants(&variants, workgroup.x, workgroup.y, output);
+    // with --shader-dir, saving a shader recompiles it in the background
+    HotReload reload;
+    int hotReload = shaderDirectory() &&
+        initHotReload(&reload, window, COMPUTE_SHADER_NAME, VERTEX_SHADER_NAME, FRAG_SHADER_NAME, createShader);
+    if (hotReload) printf("watching %s for shader edits\n", shaderDirectory());
+    int was_colour_key = 0;
+    int was_scale_key = 0;
+    int was_profile_key = 0;
+    int was_overlay_key = 0;
+    int was_screenshot_key = 0;
+    // --capture writes every rendered frame, F12 the next one
+    FrameCapture capture;
+    if (!initFrameCapture(&capture)) {
+        fprintf(stderr, "Failed to start the capture encoder\n");
+        return -1;
+    }
+    unsigned long long captureFrame = 0;
+    unsigned long long screenshotCount = 0;
+    Profiler profiler;
+    initProfiler(&profiler);
+    static FrameHistogram frameTimes;
+    initFrameHistogram(&frameTimes, budgetMs);
+    current_time = glfwGetTime();
+
+    // paced by vsync, or by sleeping to --fps when it is given
+    glfwSwapInterval(targetFps > 0.0 ? 0 : 1);
+    double nextFrame = platformTime();
+    // the view is converged once the last change has made it through the ring
+    ViewState lastState;
+    memset(&lastState, 0, sizeof(lastState));
+    int framesToConverge = 1;
+    int rendered = 0;
+    int firstFrameShown = 0;
+    int completeFrameShown = 0;
+    // whether each ring target holds a frame rendered by its chosen variant
+    int targetComplete[RENDER_RING_MAX] = {0};
+    double idleWall = 0.0;
+    double idleCpu = 0.0;
 
     int was_click = 0;
     int click = 0;
+    // A and B are UVs of the home view, C and D UVs of the window
     vec2 A = {0,0};
-    vec2 B = {SCREEN_WIDTH,SCREEN_HEIGHT};
+    vec2 B = {1,1};
     vec2 C = {0,0};
     vec2 D = {0,0};
+    // left and right arrows go back and forward through the views zoomed into
+    ZoomHistory history;
+    const double homeSection[4] = {0,0,1,1};
+    initZoomHistory(&history, homeSection, ZOOM_HISTORY_BUDGET);
+    unsigned char* historyPixels = NULL;
+    size_t historyPixelBytes = 0;
+    // the current view came back from the history and is uploaded, not rendered
+    int restoring = 0;
+    int was_back_key = 0;
+    int was_forward_key = 0;
+    // while converged the likely next views render ahead, see prefetch.h
+    Prefetcher prefetch;
+    initPrefetcher(&prefetch);
+    int was_right_click = 0;
+    // what a new section is shown from until its own frames come through the
+    // ring: a prefetched view covering it, else the last frame reprojected;
+    // an exact prefetch is the view itself
+    const RenderTarget* cover = NULL;
+    double coverSection[4] = {0,0,1,1};
+    int coverExact = 0;
+    // which state and section each ring target was rendered for
+    unsigned long long viewSerial = 0;
+    unsigned long long targetSerial[RENDER_RING_MAX] = {0};
+    double targetSections[RENDER_RING_MAX][4] = {{0}};
+    // the wheel zooms smoothly, and the frames on the way copy what they can
+    // from the last one rendered in full, the reference
+    ZoomAnimator zoomAnimator;
+    initZoomAnimator(&zoomAnimator);
+    RenderTarget reference = {0};
+    double referenceSection[4] = {0,0,1,1};
+    ViewState referenceKey;
+    int referenceValid = 0;
+    ReuseWork reuseWork = {0};
 
     while (!glfwWindowShouldClose(window)) {
-        Sleep(1);
-        CalcFPS();
+        if (framesToConverge == 0) {
+            // keep the converged image for when the history comes back here
+            RenderTarget* shown = ringPresentTarget(&ring);
+            size_t bytes = (size_t)lastState.renderWidth*lastState.renderHeight*4;
+            if (shown && targetComplete[shown - ring.targets] &&
+                !hasHistoryImage(&history, &lastState, sizeof(lastState)) &&
+                reserveBytes(&historyPixels, &historyPixelBytes, bytes)) {
+                glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+                glGetTextureSubImage(shown->texture, 0, 0, 0, 0, lastState.renderWidth, lastState.renderHeight, 1,
+                                     GL_RGBA, GL_UNSIGNED_BYTE, (GLsizei)bytes, historyPixels);
+                storeHistoryImage(&history, &lastState, sizeof(lastState),
+                                  lastState.renderWidth, lastState.renderHeight, historyPixels);
+            }
+            cover = NULL;
+            if (usePrefetch) {
+                double cursorX, cursorY;
+                int cursorWidth, cursorHeight;
+                glfwGetCursorPos(window, &cursorX, &cursorY);
+                glfwGetWindowSize(window, &cursorWidth, &cursorHeight);
+                double cursorU = -1.0;
+                double cursorV = -1.0;
+                if (cursorWidth > 0 && cursorHeight > 0 && glfwGetWindowAttrib(window, GLFW_HOVERED)) {
+                    cursorU = cursorX/cursorWidth;
+                    cursorV = 1.0 - cursorY/cursorHeight;
+                }
+                double section[4];
+                stateSection(&lastState, section);
+                ViewState key = prefetchKey(&lastState);
+                PrefetchView* ahead = nextPrefetch(&prefetch, &targetPool, section, &key, sizeof(key),
+                                                   lastState.renderWidth, lastState.renderHeight,
+                                                   outputInternalFormat(output), cursorU, cursorV, platformTime());
+                KernelVariant variant;
+                GLuint program;
+                ViewState aheadState = lastState;
+                if (ahead) {
+                    aheadState.A = (vec2){ahead->section[0], ahead->section[1]};
+                    aheadState.B = (vec2){ahead->section[2], ahead->section[3]};
+                }
+                // only with the chosen kernel, a placeholder image is no use later
+                if (ahead && requestViewProgram(&variants, workgroup, &aheadState, &variant, &program) == VARIANT_READY) {
+                    glUseProgram(program);
+                    setViewUniforms(&variant, &aheadState, (vec2){0,0});
+                    glBindImageTexture(0, ahead->target.texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, ahead->target.format);
+                    dispatchVariant(&variant, aheadState.renderWidth, aheadState.renderHeight);
+                    prefetchDispatched(&prefetch, ahead);
+                }
+            }
+            // nothing renders until the next event, let the last captures land first
+            collectCaptures(&capture, 1);
+            // the last frame ends before the wait for input, the next one starts after it
+            if (rendered) recordFrame(&frameTimes, (glfwGetTime()-current_time)*1000.0);
+            rendered = 0;
+            double idleStart = platformTime();
+            double idleCpuStart = platformCpuTime();
+            glfwWaitEventsTimeout(prefetch.pending ? PREFETCH_POLL_SECONDS : IDLE_WAIT_SECONDS);
+            idleWall += platformTime() - idleStart;
+            idleCpu += platformCpuTime() - idleCpuStart;
+            current_time = glfwGetTime();
+        } else if (targetFps > 0.0) {
+            nextFrame += 1.0/targetFps;
+            if (nextFrame < platformTime()) nextFrame = platformTime();
+            platformSleepUntil(nextFrame);
+        }
+        last_time = current_time;
+        current_time = glfwGetTime();
+        if (rendered) recordFrame(&frameTimes, (current_time-last_time)*1000.0);
+        rendered = 0;
+        collectCaptures(&capture, 0);
+        if (hotReload) {
+            unsigned swapped = updateHotReload(&reload, &variants, &screenShaderProgram);
+            if (swapped) {
+                // the profile so far belongs to the old shaders, print it and start over
+                printProfile(&profiler);
+                resetProfilerStats(&profiler);
+                if (swapped & RELOAD_SCREEN) setPresenterProgram(&presenter, screenShaderProgram);
+                // images of the old kernel must not come back
+                if (swapped & RELOAD_COMPUTE) {
+                    dropHistoryImages(&history);
+                    restoring = 0;
+                    forgetPrefetched(&prefetch);
+                    cover = NULL;
+                    coverExact = 0;
+                    referenceValid = 0;
+                }
+                framesToConverge = ring.size + 1;
+            }
+        }
+        profilerBeginFrame(&profiler);
+        profilerStage(&profiler, STAGE_INPUT, 0);
+        int winWidth, winHeight;
+        glfwGetWindowSize(window, &winWidth, &winHeight);
+        if (winWidth <= 0 || winHeight <= 0 || fbWidth <= 0 || fbHeight <= 0) {
+            // minimised
+            glfwWaitEvents();
+            continue;
+        }
         vec2 mousepos = {0,0};
         glfwGetCursorPos(window, &mousepos.x, &mousepos.y);
+        mousepos = (vec2){mousepos.x/winWidth, 1.0-mousepos.y/winHeight};
         was_click = click;
         click = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT);
         if(click && !was_click) {
-            C = (vec2){mousepos.x,SCREEN_HEIGHT-mousepos.y};
+            C = mousepos;
+            stopZoomAnimator(&zoomAnimator);
         }
+        int zoomed = 0;
         if(was_click && !click) {
-            D = (vec2){mousepos.x,SCREEN_HEIGHT-mousepos.y};
-            vec2 scale = {(B.x-A.x)/SCREEN_WIDTH,(B.y-A.y)/SCREEN_HEIGHT};
-            vec2 CD = {D.x-C.x,D.y-C.y};
-            A = (vec2){A.x+(C.x*scale.x),A.y+(C.y*scale.y)};
-            B = (vec2){CD.x*scale.x + A.x, CD.y*scale.y + A.y};
+            D = mousepos;
+            if (fabs(D.x-C.x) < CLICK_SLOP && fabs(D.y-C.y) < CLICK_SLOP) {
+                // a click zooms in twice around where it landed
+                double section[4] = {A.x,A.y,B.x,B.y};
+                double closer[4];
+                snapToPrediction(&prefetch, &C.x, &C.y);
+                zoomSection(section, C.x, C.y, 2.0, closer);
+                A = (vec2){closer[0], closer[1]};
+                B = (vec2){closer[2], closer[3]};
+            } else {
+                vec2 scale = {B.x-A.x,B.y-A.y};
+                vec2 CD = {D.x-C.x,D.y-C.y};
+                A = (vec2){A.x+(C.x*scale.x),A.y+(C.y*scale.y)};
+                B = (vec2){CD.x*scale.x + A.x, CD.y*scale.y + A.y};
+            }
             C = (vec2){0,0};
             D = (vec2){0,0};
+            pushZoomView(&history, (double[4]){A.x,A.y,B.x,B.y});
+            zoomed = 1;
+        }
+        // a right click zooms out twice around the middle
+        int right_click = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT);
+        if (right_click && !was_right_click && !click) {
+            double section[4] = {A.x,A.y,B.x,B.y};
+            double further[4];
+            zoomSection(section, 0.5, 0.5, 0.5, further);
+            A = (vec2){further[0], further[1]};
+            B = (vec2){further[2], further[3]};
+            pushZoomView(&history, further);
+            zoomed = 1;
+        }
+        was_right_click = right_click;
+
+        double steps = scroll_steps;
+        scroll_steps = 0.0;
+        if (steps != 0.0 && !click) {
+            if (!zoomAnimator.active) {
+                // the frame shown is what the first steps reuse
+                RenderTarget* newest = ringPresentTarget(&ring);
+                if (newest && targetComplete[newest - ring.targets]) {
+                    copyReference(&targetPool, &reference, newest);
+                    memcpy(referenceSection, targetSections[newest - ring.targets], sizeof(referenceSection));
+                    referenceKey = prefetchKey(&lastState);
+                    referenceValid = 1;
+                }
+            }
+            animateZoom(&zoomAnimator, (double[4]){A.x,A.y,B.x,B.y}, mousepos.x, mousepos.y,
+                        pow(ZOOM_WHEEL_STEP, steps));
         }
 
         if (glfwGetKey(window,GLFW_KEY_R)) {
+            stopZoomAnimator(&zoomAnimator);
+            if (A.x != 0 || A.y != 0 || B.x != 1 || B.y != 1) pushZoomView(&history, homeSection);
             A = (vec2){0,0};
-            B = (vec2){SCREEN_WIDTH,SCREEN_HEIGHT};
+            B = (vec2){1,1};
             C = (vec2){0,0};
             D = (vec2){0,0};
         }
 
-        glUseProgram(computeProgram);
-        glUniform1f(0, time);
-        glUniform4f(1, A.x,A.y,B.x,B.y);
-        glUniform4f(2,C.x,C.y,mousepos.x,mousepos.y);
-        glDispatchCompute(ceil(SCREEN_WIDTH/8),ceil(SCREEN_HEIGHT/4),1);
-        glMemoryBarrier(GL_ALL_BARRIER_BITS);
+        int back_key = glfwGetKey(window,GLFW_KEY_LEFT);
+        int forward_key = glfwGetKey(window,GLFW_KEY_RIGHT);
+        const HistoryEntry* visited = NULL;
+        if (back_key && !was_back_key && !click) visited = zoomBack(&history);
+        if (forward_key && !was_forward_key && !click) visited = zoomForward(&history);
+        was_back_key = back_key;
+        was_forward_key = forward_key;
+        if (visited) {
+            stopZoomAnimator(&zoomAnimator);
+            A = (vec2){visited->section[0], visited->section[1]};
+            B = (vec2){visited->section[2], visited->section[3]};
+        }
+        // the frame that arrives is rendered in full like any other view
+        int animating = 0;
+        if (zoomAnimator.active) {
+            double section[4];
+            animating = stepZoomAnimator(&zoomAnimator, current_time - last_time, section);
+            if (!animating) pushZoomView(&history, section);
+            A = (vec2){section[0], section[1]};
+            B = (vec2){section[2], section[3]};
+        }
 
-        glUseProgram(screenShaderProgram);
-        glBindTextureUnit(0, screenTexture);
-        glUniform1i(glGetUniformLocation(screenShaderProgram, "screen"), 0);
-        glBindVertexArray(quadbuf.vao);
-        glDrawElements(GL_TRIANGLES, sizeof(indices)/sizeof(indices[0]), GL_UNSIGNED_INT, 0);
+        int colour_key = glfwGetKey(window,GLFW_KEY_C);
+        if (colour_key && !was_colour_key) {
+            colour = (colour + 1) % COLOUR_MODE_COUNT;
+        }
+        was_colour_key = colour_key;
 
+        // S halves the render resolution down to a quarter, the present pass upscales
+        int scale_key = glfwGetKey(window,GLFW_KEY_S);
+        if (scale_key && !was_scale_key) {
+            renderScale = renderScale > 0.3f ? renderScale*0.5f : 1.0f;
+        }
+        was_scale_key = scale_key;
+
+        int profile_key = glfwGetKey(window,GLFW_KEY_P);
+        if (profile_key && !was_profile_key) {
+            printProfile(&profiler);
+        }
+        was_profile_key = profile_key;
+
+        int overlay_key = glfwGetKey(window,GLFW_KEY_O);
+        if (overlay_key && !was_overlay_key) {
+            showOverlay = !showOverlay;
+        }
+        was_overlay_key = overlay_key;
+
+        int screenshot_key = glfwGetKey(window,GLFW_KEY_F12);
+        int screenshot = screenshot_key && !was_screenshot_key;
+        was_screenshot_key = screenshot_key;
+
+        int renderWidth = (int)ceil(fbWidth*renderScale);
+        int renderHeight = (int)ceil(fbHeight*renderScale);
+        double depth = fmin(floor(pow(current_time,3.0)), maxDepth);
+
+        ViewState state;
+        memset(&state, 0, sizeof(state));
+        state.A = A;
+        state.B = B;
+        state.C = C;
+        // the selection box follows the mouse only while dragging
+        if (click) state.mouse = mousepos;
+        state.depth = depth;
+        state.colour = colour;
+        state.output = output;
+        state.overlay = showOverlay;
+        state.renderWidth = renderWidth;
+        state.renderHeight = renderHeight;
+        if (memcmp(&state, &lastState, sizeof(state)) != 0) {
+            lastState = state;
+            framesToConverge = ring.size + 1;
+            size_t bytes = (size_t)renderWidth*renderHeight*4;
+            restoring = visited && reserveBytes(&historyPixels, &historyPixelBytes, bytes) &&
+                restoreHistoryImage(&history, &state, sizeof(state), renderWidth, renderHeight, historyPixels);
+            viewSerial++;
+            cover = NULL;
+            coverExact = 0;
+            double section[4];
+            stateSection(&state, section);
+            PrefetchView* ahead = NULL;
+            if (zoomed && usePrefetch) {
+                ViewState key = prefetchKey(&state);
+                ahead = findPrefetched(&prefetch, section, &key, sizeof(key), &coverExact);
+            }
+            RenderTarget* previous = ringPresentTarget(&ring);
+            if (ahead) {
+                cover = &ahead->target;
+                memcpy(coverSection, ahead->section, sizeof(coverSection));
+            } else if (!restoring && previous &&
+                       memcmp(targetSections[previous - ring.targets], section, sizeof(section)) != 0) {
+                cover = previous;
+                memcpy(coverSection, targetSections[previous - ring.targets], sizeof(coverSection));
+            }
+        }
+        if (screenshot && framesToConverge == 0) {
+            // re-present the converged frame so there is something to read back
+            framesToConverge = 1;
+        }
+        if (framesToConverge == 0) {
+            // nothing changed, the last presented frame is still on screen
+            continue;
+        }
+        framesToConverge--;
+        rendered = 1;
+
+        profilerStage(&profiler, STAGE_UPLOAD, 0);
+        RenderTarget* target = beginRingFrame(&ring, &targetPool, renderWidth, renderHeight,
+                                              outputInternalFormat(output));
+        glBindImageTexture(0, target->texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, target->format);
+
+        KernelVariant variant;
+        GLuint computeProgram;
+        VariantStatus status = requestViewProgram(&variants, workgroup, &state, &variant, &computeProgram);
+        // an exact prefetch is copied in instead of rendered
+        int copying = cover && coverExact;
+        // while the chosen variant links the cheapest one stands in, and while
+        // that links too the target is cleared; the view is not converged until
+        // the real variant has rendered it
+        int placeholder = !restoring && !copying && status == VARIANT_PENDING;
+        if (placeholder) {
+            variant = placeholderVariant(&variant);
+            if (requestVariantProgram(&variants, &variant, &computeProgram) != VARIANT_READY) computeProgram = 0;
+            framesToConverge = ring.size + 1;
+        }
+        // a frame of the animation reuses the reference where it can, unless
+        // too little of it is left to be worth it; then it is rendered in full
+        // and becomes the reference
+        int reusing = 0;
+        KernelVariant fillVariant;
+        GLuint fillProgram = 0;
+        if (animating && !restoring && !copying && !placeholder && computeProgram) {
+            ViewState key = prefetchKey(&state);
+            double section[4];
+            stateSection(&state, section);
+            double share = 0.0;
+            if (referenceValid && memcmp(&key, &referenceKey, sizeof(key)) == 0) {
+                share = reusableShare(referenceSection, section);
+            }
+            fillVariant = variant;
+            fillVariant.reuse = REUSE_FILL;
+            KernelVariant copyVariant = reuseCopyVariant(&variant);
+            GLuint copyProgram;
+            // the full variant renders while the reuse passes link
+            if (share >= REUSE_MIN_SHARE &&
+                requestVariantProgram(&variants, &copyVariant, &copyProgram) == VARIANT_READY &&
+                requestVariantProgram(&variants, &fillVariant, &fillProgram) == VARIANT_READY) {
+                variant = copyVariant;
+                computeProgram = copyProgram;
+                reusing = 1;
+            }
+            countAnimatedFrame(&zoomAnimator, reusing ? share : 0.0);
+        }
+        targetComplete[target - ring.targets] = restoring || copying || (!placeholder && computeProgram && !reusing);
+        // until a frame of this view reaches the present the cover stands in,
+        // drawn before the dispatch so that it shows in this very frame
+        RenderTarget* finished = ringPresentTarget(&ring);
+        int showCover = cover && (!finished || targetSerial[finished - ring.targets] != viewSerial);
+        targetSerial[target - ring.targets] = viewSerial;
+        stateSection(&state, targetSections[target - ring.targets]);
+        if (showCover) {
+            profilerStage(&profiler, STAGE_PRESENT, 1);
+            // a prefetch is written by a dispatch after the last frame's barrier
+            glMemoryBarrier(presentBarrierBits(&presenter) | GL_TEXTURE_UPDATE_BARRIER_BIT);
+            presentReprojected(&presenter, cover, coverSection, targetSections[target - ring.targets],
+                               0, fbWidth, fbHeight);
+        }
+
+        if (computeProgram) {
+            glUseProgram(computeProgram);
+            setViewUniforms(&variant, &state, mousepos);
+        }
+        if (reusing) {
+            setReferenceUniform(&variant, referenceSection[0], referenceSection[1],
+                                referenceSection[2], referenceSection[3]);
+            glBindImageTexture(1, reference.texture, 0, GL_FALSE, 0, GL_READ_ONLY, reference.format);
+            resetReuseWork(&reuseWork, renderWidth, renderHeight);
+        }
+
+        // the barrier makes last frame's image visible to the present. With a
+        // ring the present and the fence after it go before this frame's
+        // dispatch, so the target is free for the next frame as soon as it has
+        // been read while the GPU is still on this one
+        GLbitfield presentBarrier = presentBarrierBits(&presenter);
+        if (capturePattern || screenshot) presentBarrier |= CAPTURE_BARRIER_BITS;
+        int presenting = !showCover && finished;
+        if (ring.size > 1) {
+            profilerStage(&profiler, STAGE_BARRIER, 1);
+            glMemoryBarrier(presentBarrier);
+            if (presenting) {
+                profilerStage(&profiler, STAGE_PRESENT, 1);
+                presentFinished(&presenter, &capture, finished, capturePattern, &captureFrame,
+                                screenshot, &screenshotCount);
+            }
+            fenceRingPresent(&ring);
+        }
+        profilerStage(&profiler, STAGE_DISPATCH, 1);
+        if (restoring) {
+            glTextureSubImage2D(target->texture, 0, 0, 0, renderWidth, renderHeight,
+                                GL_RGBA, GL_UNSIGNED_BYTE, historyPixels);
+        } else if (copying) {
+            glCopyImageSubData(cover->texture, GL_TEXTURE_2D, 0, 0, 0, 0,
+                               target->texture, GL_TEXTURE_2D, 0, 0, 0, 0, renderWidth, renderHeight, 1);
+        } else if (reusing) {
+            dispatchVariant(&variant, renderWidth, renderHeight);
+            glUseProgram(fillProgram);
+            setViewUniforms(&fillVariant, &state, mousepos);
+            dispatchReuseFill(&reuseWork);
+        } else if (computeProgram) {
+            dispatchVariant(&variant, renderWidth, renderHeight);
+            if (animating && !reusing && targetComplete[target - ring.targets]) {
+                copyReference(&targetPool, &reference, target);
+                stateSection(&state, referenceSection);
+                referenceKey = prefetchKey(&state);
+                referenceValid = 1;
+            }
+        } else {
+            const float grey[4] = {PLACEHOLDER_GREY, PLACEHOLDER_GREY, PLACEHOLDER_GREY, 1.0f};
+            glClearTexImage(target->texture, 0, GL_RGBA, GL_FLOAT, grey);
+        }
+        if (ring.size == 1) {
+            profilerStage(&profiler, STAGE_BARRIER, 1);
+            glMemoryBarrier(presentBarrier);
+            if (presenting) {
+                profilerStage(&profiler, STAGE_PRESENT, 1);
+                presentFinished(&presenter, &capture, finished, capturePattern, &captureFrame,
+                                screenshot, &screenshotCount);
+            }
+        }
+        int completePresented = presenting && targetComplete[finished - ring.targets];
+        endRingFrame(&ring);
+        if (showOverlay) drawFrameOverlay(&frameTimes, fbWidth, fbHeight);
+
+        profilerStage(&profiler, STAGE_SWAP, 1);
         glfwSwapBuffers(window);
+        if (!firstFrameShown) {
+            firstFrameShown = 1;
+            printf("first frame after %.1f ms\n", (platformTime() - startTime) * 1000.0);
+        }
+        if (completePresented && !completeFrameShown) {
+            completeFrameShown = 1;
+            printf("first frame with its chosen variant after %.1f ms\n", (platformTime() - startTime) * 1000.0);
+            printProgramCache(&programCache);
+        }
         glfwPollEvents();
+        profilerEndFrame(&profiler);
+    }
+    destroyFrameCapture(&capture);
+    if (capture.captured || capture.dropped) {
+        printf("captured %llu frames, dropped %llu, failed %llu\n",
+               capture.captured, capture.dropped, capture.failed);
+    }
+    printProfile(&profiler);
+    destroyProfiler(&profiler);
+    if (traceEnabled()) {
+        if (writeTrace(TRACE_PATH)) printf("trace written to %s\n", TRACE_PATH);
+        else fprintf(stderr, "Failed to write %s\n", TRACE_PATH);
+    }
+    printFrameHistogram(&frameTimes);
+    printZoomHistory(&history);
+    if (usePrefetch) printPrefetcher(&prefetch);
+    if (zoomAnimator.frames) printZoomAnimator(&zoomAnimator);
+    destroyZoomHistory(&history);
+    free(historyPixels);
+    if (idleWall > 0.0) {
+        printf("idle %.1f s, CPU usage while idle %.2f%%\n", idleWall, 100.0*idleCpu/idleWall);
+    }
+    if (!writeFrameHistogram(&frameTimes, FRAME_TIMES_PATH)) {
+        fprintf(stderr, "Failed to write %s\n", FRAME_TIMES_PATH);
     }
-    printf("avg framerate: %f\n",avgFPS);
+    destroyPresenter(&presenter);
     glDeleteVertexArrays(1, &quadbuf.vao);
     glDeleteBuffers(1, &quadbuf.vbo);
     glDeleteBuffers(1, &quadbuf.ebo);
-    glDeleteTextures(1, &screenTexture);
+    destroyPrefetcher(&prefetch, &targetPool);
+    releaseTarget(&targetPool, &reference);
+    destroyReuseWork(&reuseWork);
+    destroyRenderRing(&ring, &targetPool);
+    destroyTargetPool(&targetPool);
     glDeleteProgram(screenShaderProgram);
+    destroyVariantCache(&variants);
+    // after the cache, which may point at the reloaded source
+    if (hotReload) destroyHotReload(&reload);
     free((void*)vertexShaderSource);
     free((void*)fragmentShaderSource);
     free((void*)computeShaderSource);
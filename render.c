@@ -0,0 +1,557 @@
+// Headless batch renderer: renders views to image files without a window,
+// on the CPU backend or, with --gpu, the compute kernel on a surfaceless EGL
+// context (built with HEADLESS_EGL, Linux only).
+//
+//   render [--view name] [--center x y] [--span s] [--depth n] [--size w h]
+//          [--colour n] [--threads n] [--unroll k] [--out path]
+//          [--gpu] [--shader-dir dir] [--no-program-cache] [--tile-cache mb]
+//          [--tile-store path] [--tile-store-size mb]
+//          [--zoom-frames n] [--zoom-factor f] [--exp-map] [--trace file]
+//   render [--size w h] ... --list file
+//
+// A list file has one view per line, "cx cy span depth path"; blank lines
+// and lines starting with # are skipped. The format of every output follows
+// its extension: .ppm, .png (RGB8) or .pfm (escape iteration per pixel, CPU only).
+// With --tile-cache the CPU backend keeps up to mb megabytes of rendered tiles,
+// so views of a list that overlap only render what the earlier ones did not.
+// --tile-store keeps tiles in a file (created with --tile-store-size mb), which
+// later runs and renders running at the same time share.
+// --zoom-frames renders n frames zooming f times closer each (default 1.02)
+// into the output path numbered like the captures, "zoom.png" -> "zoom00000.png".
+// On the CPU a frame takes the samples of the last fully rendered one that are
+// within half a pixel of its own and iterates only the rest; once less than
+// half of it could, it is rendered in full and becomes the reference.
+// With --exp-map (CPU, zooming in) the frames are instead resampled from one
+// log-polar strip around the centre, angle by log radius, which costs about
+// as much as a handful of frames however long the zoom is; the few pixels at
+// the centre of each frame that the strip does not reach are iterated.
+// --trace writes a Chrome trace of every worker tile to file.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/mandel.h"
+#include "src/cpu_render.h"
+#include "src/image_io.h"
+#include "src/platform.h"
+#include "src/trace.h"
+#include "src/zoom_animator.h"
+#ifdef HEADLESS_EGL
+#include "src/egl_context.h"
+#include "src/gpu_render.h"
+#include "src/program_cache.h"
+#include "src/shader_source.h"
+#endif
+
+#define DEFAULT_WIDTH 1920
+#define DEFAULT_HEIGHT 1080
+#define DEFAULT_OUTPUT "mandel.png"
+#define DEFAULT_UNROLL 4
+// below this depth unrolling costs more than the escape checks it saves
+#define SHALLOW_DEPTH 64
+#define LIST_LINE_MAX 1024
+#define COMPUTE_SHADER_NAME "compute_shader.glsl"
+#define DEFAULT_ZOOM_FACTOR 1.02
+#define FRAME_PATH_MAX 1024
+#define TWO_PI 6.283185307179586
+// radius of the disc at the centre of an exp map frame that is iterated
+#define EXP_MAP_DISC_PIXELS 8.0
+// rows of the exp map rendered at once beyond those the current frame needs
+#define EXP_MAP_BAND_ROWS 256
+
+typedef struct {
+    int width;
+    int height;
+    int colour;
+    int threads;
+    int unroll;
+    // NULL renders every view from scratch
+    TileCache* tiles;
+    TileStore* store;
+    // frames reuse the samples of the last full render
+    int reuse;
+#ifdef HEADLESS_EGL
+    // NULL renders on the CPU
+    VariantCache* variants;
+#endif
+} RenderOptions;
+
+typedef struct {
+    int* iters;
+    unsigned char* rgb;
+    float* values;
+    // the last full render, when reusing
+    int* reference;
+    MandelView referenceView;
+    int hasReference;
+    size_t pixels;
+} RenderBuffers;
+
+static double startTime;
+static double firstByteTime;
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: render [--view name] [--center x y] [--span s] [--depth n] [--size w h]\n"
+            "              [--colour n] [--threads n] [--unroll k] [--out path] [--list file]\n"
+            "              [--gpu] [--shader-dir dir] [--no-program-cache] [--tile-cache mb]\n"
+            "              [--tile-store path] [--tile-store-size mb]\n"
+            "              [--zoom-frames n] [--zoom-factor f] [--exp-map] [--trace file]\n");
+}
+
+static int reserveBuffers(RenderBuffers* b, int width, int height, int reuse) {
+    size_t pixels = (size_t)width * height;
+    if (pixels <= b->pixels && (!reuse || b->reference)) return 1;
+    free(b->iters);
+    free(b->rgb);
+    free(b->values);
+    free(b->reference);
+    b->iters = malloc(pixels * sizeof(int));
+    b->rgb = malloc(pixels * 3);
+    b->values = malloc(pixels * sizeof(float));
+    b->reference = reuse ? malloc(pixels * sizeof(int)) : NULL;
+    b->hasReference = 0;
+    b->pixels = b->iters && b->rgb && b->values && (!reuse || b->reference) ? pixels : 0;
+    return b->pixels != 0;
+}
+
+// whether view can be rendered from the reference, the share it can take
+static double referenceShare(const RenderBuffers* b, const MandelView* view, int width, int height) {
+    if (!b->hasReference || b->referenceView.depth != view->depth) return 0.0;
+    double reference[4], section[4];
+    mandelViewSection(&b->referenceView, width, height, reference);
+    mandelViewSection(view, width, height, section);
+    return reusableShare(reference, section);
+}
+
+// writes the width x height frame in buffers, colouring iters unless the GPU
+// rendered straight into rgb
+static int writeFrame(const MandelView* view, const char* path, int format, int fromIters,
+                      const RenderOptions* options, RenderBuffers* buffers) {
+    int width = options->width, height = options->height;
+    size_t pixels = (size_t)width * height;
+    double firstByte = 0.0;
+    int ok;
+    if (!fromIters) {
+        ok = format == IMAGE_PNG ? writePNG(path, width, height, buffers->rgb, &firstByte)
+                                 : writePPM(path, width, height, buffers->rgb, &firstByte);
+    } else if (format == IMAGE_PFM) {
+        for (size_t p = 0; p < pixels; p++) buffers->values[p] = (float)buffers->iters[p];
+        ok = writePFM(path, width, height, buffers->values, &firstByte);
+    } else {
+        for (size_t p = 0; p < pixels; p++) {
+            mandelColour(buffers->iters[p], view->depth, options->colour, &buffers->rgb[p*3]);
+        }
+        ok = format == IMAGE_PNG ? writePNG(path, width, height, buffers->rgb, &firstByte)
+                                 : writePPM(path, width, height, buffers->rgb, &firstByte);
+    }
+    if (!ok) {
+        fprintf(stderr, "Failed to write %s\n", path);
+        return 0;
+    }
+    if (firstByteTime == 0.0) firstByteTime = firstByte;
+    return 1;
+}
+
+static int renderToFile(const MandelView* view, const char* path,
+                        const RenderOptions* options, RenderBuffers* buffers) {
+    int format = imageFormatFromPath(path);
+    if (format < 0) {
+        fprintf(stderr, "%s: unknown image format, use .ppm, .png or .pfm\n", path);
+        return 0;
+    }
+    int width = options->width, height = options->height;
+    if (!reserveBuffers(buffers, width, height, options->reuse)) {
+        fprintf(stderr, "Failed to allocate %dx%d pixels\n", width, height);
+        return 0;
+    }
+
+    double renderStart = platformTime();
+    // 0 when the GPU rendered straight into rgb
+    int threads = 0;
+    TileUsage tileUsage = {0};
+    // -1 when rendered in full
+    long long reused = -1;
+#ifdef HEADLESS_EGL
+    GpuRenderTimes gpuTimes = {0};
+    if (options->variants) {
+        if (format == IMAGE_PFM) {
+            fprintf(stderr, "%s: the GPU kernel only writes colours, PFM needs the CPU backend\n", path);
+            return 0;
+        }
+        if (!gpuRenderView(options->variants, view, width, height, (ColourMode)options->colour,
+                           buffers->rgb, &gpuTimes)) {
+            fprintf(stderr, "%s: GPU render failed\n", path);
+            return 0;
+        }
+    } else
+#endif
+    {
+        int unroll = view->depth < SHALLOW_DEPTH ? 1 : options->unroll;
+        if (options->reuse && referenceShare(buffers, view, width, height) >= REUSE_MIN_SHARE) {
+            threads = cpuRenderViewReusing(&buffers->referenceView, buffers->reference, view, width, height,
+                                           mandelGetIterate(unroll), options->threads, buffers->iters, &reused);
+        } else if (options->tiles || options->store) {
+            threads = cpuRenderViewCached(options->tiles, options->store, view, width, height, mandelGetIterate(unroll),
+                                          options->threads, buffers->iters, &tileUsage);
+        } else {
+            threads = cpuRenderView(view, width, height, mandelGetIterate(unroll),
+                                    options->threads, buffers->iters);
+        }
+        if (options->reuse && reused < 0) {
+            memcpy(buffers->reference, buffers->iters, (size_t)width * height * sizeof(int));
+            buffers->referenceView = *view;
+            buffers->hasReference = 1;
+        }
+    }
+
+    double writeStart = platformTime();
+    if (!writeFrame(view, path, format, threads != 0, options, buffers)) return 0;
+    double end = platformTime();
+    size_t pixels = (size_t)width * height;
+    if (threads == 0) {
+#ifdef HEADLESS_EGL
+        printf("%s: %dx%d depth %d, GPU render %.1f ms, readback %.1f ms, write %.1f ms\n",
+               path, width, height, view->depth, gpuTimes.dispatchMs, gpuTimes.readbackMs,
+               (end - writeStart)*1000.0);
+#endif
+    } else {
+        printf("%s: %dx%d depth %d, render %.1f ms on %d threads, write %.1f ms",
+               path, width, height, view->depth, (writeStart - renderStart)*1000.0, threads,
+               (end - writeStart)*1000.0);
+        if (tileUsage.needed) {
+            printf(", %d of %d level %d tiles cached", tileUsage.cached + tileUsage.stored,
+                   tileUsage.needed, tileUsage.level);
+            if (options->store) printf(" (%d from the store)", tileUsage.stored);
+        } else if (tileUsage.offGrid) {
+            printf(", off the tile grid");
+        } else if (options->tiles || options->store) {
+            printf(", too many tiles for the cache");
+        }
+        if (reused >= 0) {
+            printf(", %.1f%% reused", 100.0*(double)reused/(double)pixels);
+        } else if (options->reuse) {
+            printf(", full render");
+        }
+        printf("\n");
+    }
+    return 1;
+}
+
+static int renderList(const char* listPath, const RenderOptions* options, RenderBuffers* buffers) {
+    FILE* fp = fopen(listPath, "r");
+    if (!fp) {
+        fprintf(stderr, "Failed to open %s\n", listPath);
+        return 0;
+    }
+    char line[LIST_LINE_MAX];
+    char path[LIST_LINE_MAX];
+    int lineNumber = 0;
+    int failed = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        lineNumber++;
+        char* start = line + strspn(line, " \t");
+        if (*start == '#' || *start == '\n' || *start == '\0') continue;
+        MandelView view = {"list", 0.0, 0.0, 0.0, 0};
+        if (sscanf(start, "%lf %lf %lf %d %1023s", &view.cx, &view.cy, &view.span,
+                   &view.depth, path) != 5 || view.span <= 0.0 || view.depth < 1) {
+            fprintf(stderr, "%s:%d: expected \"cx cy span depth path\"\n", listPath, lineNumber);
+            failed = 1;
+            continue;
+        }
+        if (!renderToFile(&view, path, options, buffers)) failed = 1;
+    }
+    fclose(fp);
+    return !failed;
+}
+
+static int renderZoom(const MandelView* view, const char* output, int frames, double factor,
+                      const RenderOptions* options, RenderBuffers* buffers) {
+    MandelView frame = *view;
+    char path[FRAME_PATH_MAX];
+    for (int i = 0; i < frames; i++) {
+        formatFramePath(path, sizeof(path), output, (unsigned long long)i);
+        if (!renderToFile(&frame, path, options, buffers)) return 0;
+        frame.span /= factor;
+    }
+    return 1;
+}
+
+// the zoom from a single exponential map around the centre: each frame is a
+// run of its rows, resampled, with the disc at the centre iterated directly.
+// The map is rendered a band at a time as the frames move inward and only the
+// rows the current frame needs are kept.
+static int renderExpMapZoom(const MandelView* view, const char* output, int frames, double factor,
+                            const RenderOptions* options, RenderBuffers* buffers) {
+    int format = imageFormatFromPath(output);
+    if (format < 0) {
+        fprintf(stderr, "%s: unknown image format, use .ppm, .png or .pfm\n", output);
+        return 0;
+    }
+    int width = options->width, height = options->height;
+    if (!reserveBuffers(buffers, width, height, 0)) {
+        fprintf(stderr, "Failed to allocate %dx%d pixels\n", width, height);
+        return 0;
+    }
+    // a column per pixel of the circle through the corners of a frame
+    double cornerPixels = 0.5*sqrt((double)width*width + (double)height*height);
+    ExpMap map = {view->cx, view->cy, 0.0, 0.0, 0};
+    map.columns = (int)ceil(TWO_PI*cornerPixels);
+    map.step = TWO_PI/map.columns;
+    map.logRadius = log(cornerPixels*view->span/width);
+    double lastSpan = view->span/pow(factor, frames - 1);
+    int totalRows = (int)ceil((map.logRadius - log(EXP_MAP_DISC_PIXELS*lastSpan/width))/map.step) + 1;
+    int frameRows = (int)ceil(log(cornerPixels/EXP_MAP_DISC_PIXELS)/map.step) + 2;
+    int capacity = frameRows + EXP_MAP_BAND_ROWS;
+    int* strip = malloc((size_t)capacity * map.columns * sizeof(int));
+    if (!strip) {
+        fprintf(stderr, "Failed to allocate %d x %d exp map samples\n", map.columns, capacity);
+        return 0;
+    }
+    printf("exp map: %d x %d samples, %.1f MB kept\n", map.columns, totalRows,
+           (double)capacity*map.columns*sizeof(int)/(1024.0*1024.0));
+
+    int unroll = view->depth < SHALLOW_DEPTH ? 1 : options->unroll;
+    MandelIterateFn iterate = mandelGetIterate(unroll);
+    MandelView frame = *view;
+    char path[FRAME_PATH_MAX];
+    // the strip holds rows [base, base + filled)
+    int base = 0, filled = 0;
+    double mapMs = 0.0;
+    int threads = 0;
+    long long iterated = 0;
+    int ok = 1;
+    for (int i = 0; i < frames && ok; i++) {
+        int first = (int)floor(i*log(factor)/map.step);
+        int needed = first + frameRows < totalRows ? first + frameRows : totalRows;
+        if (needed > base + filled) {
+            double mapStart = platformTime();
+            int keep = base + filled - first;
+            if (keep > 0) {
+                memmove(strip, strip + (size_t)(first - base)*map.columns, (size_t)keep*map.columns*sizeof(int));
+            } else {
+                keep = 0;
+            }
+            base = first;
+            filled = first + capacity < totalRows ? capacity : totalRows - first;
+            threads = cpuRenderExpMap(&map, view->depth, base + keep, filled - keep, iterate,
+                                      options->threads, strip + (size_t)keep*map.columns);
+            mapMs += (platformTime() - mapStart)*1000.0;
+        }
+
+        double resampleStart = platformTime();
+        long long frameIterated;
+        cpuResampleExpMap(&map, strip, base, filled, &frame, width, height, EXP_MAP_DISC_PIXELS,
+                          iterate, options->threads, buffers->iters, &frameIterated);
+        iterated += frameIterated;
+        double writeStart = platformTime();
+        formatFramePath(path, sizeof(path), output, (unsigned long long)i);
+        ok = writeFrame(&frame, path, format, 1, options, buffers);
+        double end = platformTime();
+        if (ok) {
+            printf("%s: %dx%d depth %d, resample %.1f ms, %lld pixels iterated, write %.1f ms\n",
+                   path, width, height, frame.depth, (writeStart - resampleStart)*1000.0, frameIterated,
+                   (end - writeStart)*1000.0);
+        }
+        frame.span /= factor;
+    }
+    double samples = (double)totalRows*map.columns + (double)iterated;
+    printf("exp map: rendered in %.1f ms on %d threads, %.0f samples, %.1f%% of rendering every frame\n",
+           mapMs, threads, samples, 100.0*samples/((double)frames*width*height));
+    free(strip);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    startTime = platformTime();
+
+    RenderOptions options = {0};
+    options.width = DEFAULT_WIDTH;
+    options.height = DEFAULT_HEIGHT;
+    options.threads = platformCpuCount();
+    options.unroll = DEFAULT_UNROLL;
+    MandelView view = MANDEL_STANDARD_VIEWS[0];
+    const char* output = DEFAULT_OUTPUT;
+    const char* listPath = NULL;
+    int gpu = 0;
+    const char* shaderDir = NULL;
+    int useProgramCache = 1;
+    double tileCacheMb = 0.0;
+    const char* tileStorePath = NULL;
+    double tileStoreMb = TILE_STORE_DEFAULT_MB;
+    int zoomFrames = 0;
+    double zoomFactor = DEFAULT_ZOOM_FACTOR;
+    int expMap = 0;
+    const char* tracePath = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--view") == 0 && i+1 < argc) {
+            const char* name = argv[++i];
+            int found = 0;
+            for (int v = 0; v < MANDEL_STANDARD_VIEW_COUNT; v++) {
+                if (strcmp(MANDEL_STANDARD_VIEWS[v].name, name) == 0) {
+                    view = MANDEL_STANDARD_VIEWS[v];
+                    found = 1;
+                }
+            }
+            if (!found) {
+                fprintf(stderr, "Unknown view %s\n", name);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--center") == 0 && i+2 < argc) {
+            view.cx = atof(argv[++i]);
+            view.cy = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--span") == 0 && i+1 < argc) {
+            view.span = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--depth") == 0 && i+1 < argc) {
+            view.depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--size") == 0 && i+2 < argc) {
+            options.width = atoi(argv[++i]);
+            options.height = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--colour") == 0 && i+1 < argc) {
+            options.colour = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i+1 < argc) {
+            options.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--unroll") == 0 && i+1 < argc) {
+            options.unroll = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--out") == 0 && i+1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "--list") == 0 && i+1 < argc) {
+            listPath = argv[++i];
+        } else if (strcmp(argv[i], "--gpu") == 0) {
+            gpu = 1;
+        } else if (strcmp(argv[i], "--shader-dir") == 0 && i+1 < argc) {
+            shaderDir = argv[++i];
+        } else if (strcmp(argv[i], "--no-program-cache") == 0) {
+            useProgramCache = 0;
+        } else if (strcmp(argv[i], "--tile-cache") == 0 && i+1 < argc) {
+            tileCacheMb = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--tile-store") == 0 && i+1 < argc) {
+            tileStorePath = argv[++i];
+        } else if (strcmp(argv[i], "--tile-store-size") == 0 && i+1 < argc) {
+            tileStoreMb = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--zoom-frames") == 0 && i+1 < argc) {
+            zoomFrames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--zoom-factor") == 0 && i+1 < argc) {
+            zoomFactor = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--exp-map") == 0) {
+            expMap = 1;
+        } else if (strcmp(argv[i], "--trace") == 0 && i+1 < argc) {
+            tracePath = argv[++i];
+            traceEnable();
+            traceThreadName("main");
+        } else {
+            usage();
+            return -1;
+        }
+    }
+    if (options.width <= 0 || options.height <= 0 || view.span <= 0.0 || view.depth < 1 ||
+        zoomFrames < 0 || zoomFactor <= 0.0 || (zoomFrames && listPath) ||
+        (expMap && (zoomFrames < 1 || zoomFactor <= 1.0))) {
+        usage();
+        return -1;
+    }
+    if (!mandelGetIterate(options.unroll)) {
+        fprintf(stderr, "No kernel with unroll %d\n", options.unroll);
+        return -1;
+    }
+
+#ifdef HEADLESS_EGL
+    HeadlessContext context = {0};
+    VariantCache variants;
+    ProgramCache programCache;
+    char* computeSource = NULL;
+    if (gpu) {
+        if (!createHeadlessContext(&context)) return -1;
+        setShaderDirectory(shaderDir);
+        computeSource = loadShaderSource(COMPUTE_SHADER_NAME);
+        if (!computeSource) {
+            destroyHeadlessContext(&context);
+            return -1;
+        }
+        setShaderVersion(computeSource, headlessGlslVersion(&context));
+        initVariantCache(&variants, computeSource);
+        initProgramCache(&programCache, PROGRAM_CACHE_DIR);
+        if (!useProgramCache) programCache.enabled = 0;
+        variants.binaries = &programCache;
+        options.variants = &variants;
+        printf("GL %d.%d on %s\n", context.major, context.minor, (const char*)glGetString(GL_RENDERER));
+    }
+#else
+    (void)shaderDir;
+    (void)useProgramCache;
+    if (gpu) {
+        fprintf(stderr, "Built without HEADLESS_EGL, only the CPU backend is available\n");
+        return -1;
+    }
+#endif
+
+    TileCache tiles;
+    TileStore store;
+    if (expMap && gpu) {
+        fprintf(stderr, "The exp map is rendered on the CPU, --exp-map is ignored with --gpu\n");
+        expMap = 0;
+    }
+    if ((tileCacheMb > 0.0 || tileStorePath) && gpu) {
+        fprintf(stderr, "Tiles hold CPU iterations, --tile-cache and --tile-store are ignored with --gpu\n");
+        tileCacheMb = 0.0;
+        tileStorePath = NULL;
+    }
+    if (tileStorePath) {
+        if (!openTileStore(&store, tileStorePath, tileStoreMb)) return -1;
+        options.store = &store;
+    }
+    if (tileCacheMb > 0.0) {
+        if (!initTileCache(&tiles, (size_t)(tileCacheMb*1024.0*1024.0))) {
+            fprintf(stderr, "Failed to allocate a %.1f MB tile cache\n", tileCacheMb);
+            return -1;
+        }
+        options.tiles = &tiles;
+    }
+
+    // the GPU renders every frame in full, fast enough not to need it
+    options.reuse = zoomFrames > 0 && !gpu && !expMap;
+    RenderBuffers buffers = {0};
+    int ok;
+    if (listPath) {
+        ok = renderList(listPath, &options, &buffers);
+    } else if (expMap) {
+        ok = renderExpMapZoom(&view, output, zoomFrames, zoomFactor, &options, &buffers);
+    } else if (zoomFrames > 0) {
+        ok = renderZoom(&view, output, zoomFrames, zoomFactor, &options, &buffers);
+    } else {
+        ok = renderToFile(&view, output, &options, &buffers);
+    }
+    free(buffers.iters);
+    free(buffers.rgb);
+    free(buffers.values);
+    free(buffers.reference);
+    if (options.tiles) {
+        printTileCache(&tiles);
+        destroyTileCache(&tiles);
+    }
+    if (options.store) {
+        printTileStore(&store);
+        closeTileStore(&store);
+    }
+#ifdef HEADLESS_EGL
+    if (gpu) {
+        printProgramCache(&programCache);
+        destroyVariantCache(&variants);
+        free(computeSource);
+        destroyHeadlessContext(&context);
+    }
+#endif
+
+    double end = platformTime();
+    if (firstByteTime > 0.0) {
+        printf("startup to first byte %.1f ms\n", (firstByteTime - startTime)*1000.0);
+    }
+    printf("total %.1f ms\n", (end - startTime)*1000.0);
+    if (tracePath) {
+        if (writeTrace(tracePath)) printf("trace written to %s\n", tracePath);
+        else fprintf(stderr, "Failed to write %s\n", tracePath);
+    }
+    return ok ? 0 : 1;
+}
@@ -1,33 +1,154 @@
 #version 460 core
-layout(local_size_x = 8, local_size_y = 4, local_size_z = 1) in;
-layout(rgba32f, binding = 0) uniform image2D screen;
-layout(location = 0) uniform float time;
-layout(location = 1) uniform vec4 section;
+// variant defines are inserted here by buildVariantSource
+#ifndef PRECISION_DOUBLE
+#define PRECISION_DOUBLE 0
+#endif
+#ifndef LOCAL_X
+#define LOCAL_X 8
+#endif
+#ifndef LOCAL_Y
+#define LOCAL_Y 4
+#endif
+// iterations run between two escape checks
+#ifndef UNROLL
+#define UNROLL 4
+#endif
+#ifndef INTERIOR_CHECK
+#define INTERIOR_CHECK 0
+#endif
+// 0 palette, 1 smooth, 2 grey
+#ifndef COLOUR_MODE
+#define COLOUR_MODE 0
+#endif
+// has to match the internal format of the bound image
+#ifndef OUTPUT_FORMAT
+#define OUTPUT_FORMAT rgba8
+#endif
+// 1 copies what the reference frame already has and lists the other pixels,
+// 2 iterates only the listed pixels
+#ifndef REUSE
+#define REUSE 0
+#endif
+
+#if PRECISION_DOUBLE
+#define real double
+#define real2 dvec2
+#define real4 dvec4
+#else
+#define real float
+#define real2 vec2
+#define real4 vec4
+#endif
+
+#if REUSE == 2
+layout(local_size_x = LOCAL_X*LOCAL_Y, local_size_y = 1, local_size_z = 1) in;
+#else
+layout(local_size_x = LOCAL_X, local_size_y = LOCAL_Y, local_size_z = 1) in;
+#endif
+layout(OUTPUT_FORMAT, binding = 0) uniform writeonly image2D screen;
+layout(location = 0) uniform float depth;
+layout(location = 1) uniform real4 section;
 layout(location = 2) uniform vec4 mouse;
+// pixels being rendered, the image itself may be larger
+layout(location = 3) uniform ivec2 size;
+#if REUSE == 1
+// an earlier frame of the same size and its section
+layout(OUTPUT_FORMAT, binding = 1) uniform readonly image2D reference;
+layout(location = 4) uniform real4 referenceSection;
+#endif
+#if REUSE
+// starts with the indirect dispatch of the second pass, one workgroup per
+// LOCAL_X*LOCAL_Y listed pixels
+layout(std430, binding = 2) buffer ReuseWork {
+    uint groupsX;
+    uint groupsY;
+    uint groupsZ;
+    uint count;
+    uint pixels[];
+} work;
+#endif
 
 void main() {
+#if REUSE == 2
+    if (gl_GlobalInvocationID.x >= work.count) return;
+    uint listed = work.pixels[gl_GlobalInvocationID.x];
+    ivec2 pixelCoords = ivec2(int(listed % uint(size.x)), int(listed / uint(size.x)));
+#else
     ivec2 pixelCoords = ivec2(gl_GlobalInvocationID.xy);
-    ivec2 totalPixels = ivec2(gl_NumWorkGroups.xy*gl_WorkGroupSize.xy);
-    vec2 offset = section.xy/vec2(totalPixels);
-    vec2 scaling = section.zw/vec2(totalPixels) - offset;
-    vec2 clickUV = mouse.xy/vec2(totalPixels);
-    vec2 UVs = vec2(pixelCoords)/vec2(totalPixels);
-    vec2 scaled_UVs = UVs*(scaling) + offset;
-
-    vec2 c;
+    if (any(greaterThanEqual(pixelCoords, size))) return;
+#endif
+
+    // section is in UVs of the home view, mouse in UVs of the screen
+    real2 offset = section.xy;
+    real2 scaling = section.zw - offset;
+    vec2 clickUV = mouse.xy;
+    vec2 UVs = vec2(pixelCoords)/vec2(size);
+    real2 scaled_UVs = real2(pixelCoords)/real2(size)*(scaling) + offset;
+
+#if REUSE == 1
+    // the reference sample nearest to this one is taken if it is less than
+    // half of this frame's pixel away, the pixel is left to the second pass
+    // otherwise; listing them keeps its invocations all busy
+    real2 referenceScaling = referenceSection.zw - referenceSection.xy;
+    real2 r = (scaled_UVs - referenceSection.xy)/referenceScaling*real2(size);
+    real2 nearest = floor(r + 0.5);
+    vec2 error = vec2(abs((r - nearest)*referenceScaling/scaling));
+    if (all(lessThanEqual(error, vec2(0.5))) && all(greaterThanEqual(nearest, real2(0.0))) &&
+        all(lessThan(nearest, real2(size)))) {
+        imageStore(screen, pixelCoords, imageLoad(reference, ivec2(nearest)));
+    } else {
+        uint slot = atomicAdd(work.count, 1u);
+        if (slot % uint(LOCAL_X*LOCAL_Y) == 0u) atomicAdd(work.groupsX, 1u);
+        work.pixels[slot] = uint(pixelCoords.y*size.x + pixelCoords.x);
+    }
+    return;
+#endif
+
+    real2 c;
     c.x = (3.5*scaled_UVs.x) - 2.5;
     c.y = (3.0*scaled_UVs.y) - 1.5;
 
     vec3 px = vec3(0.0);
-    float depth = floor(pow(time,3.0));
-    vec2 z = vec2(0.0);
+    real2 z = real2(0.0);
 
-    int i;
-    for (i = 0; i <= int(depth); i++) {
-        z = vec2(pow(z.x,2.0) - pow(z.y,2.0),(2.0*z.x*z.y)) + c;
-        if (length(z) > 2.0) {
+    int maxIter = int(depth);
+    int i = 0;
+#if INTERIOR_CHECK
+    // main cardioid and period-2 bulb never escape
+    real2 d = c - real2(0.25, 0.0);
+    real q = dot(d,d);
+    if (q*(q + d.x) <= 0.25*c.y*c.y || dot(c + real2(1.0, 0.0), c + real2(1.0, 0.0)) <= 0.0625) {
+        i = maxIter + 1;
+    }
+#endif
+    // UNROLL iterations per escape check, on escape roll back to the saved z
+    // and let the loop below find the exact iteration
+    while (i + UNROLL <= maxIter + 1) {
+        real2 saved = z;
+        for (int k = 0; k < UNROLL; k++) {
+            z = real2(z.x*z.x - z.y*z.y, 2.0*z.x*z.y) + c;
+        }
+        if (!(dot(z,z) <= 4.0)) {
+            z = saved;
+            break;
+        }
+        i += UNROLL;
+    }
+    for (; i <= maxIter; i++) {
+        z = real2(z.x*z.x - z.y*z.y, 2.0*z.x*z.y) + c;
+        if (dot(z,z) > 4.0) {
+#if COLOUR_MODE == 1
+            // continuous escape count removes the banding
+            float nu = log2(log2(float(dot(z,z)))*0.5);
+            float s = clamp((float(i) + 1.0 - nu)/depth, 0.0, 1.0);
+#else
             float s = float(i)/depth;
+#endif
+#if COLOUR_MODE == 2
+            px = vec3(s);
+#else
             px = vec3((cos(pow(1.4,s*8))+1)*0.3, s, 1.5  -s);
+#endif
             break;
         }
     }
@@ -2,9 +2,15 @@
 
 out vec4 FragColor;
 uniform sampler2D screen;
+// the part of the texture shown, the texture is allocated with some slack
+uniform vec2 uvScale;
+uniform vec2 uvOffset;
+// the centre of the last rendered texel, linear filtering past it would blend
+// in the slack
+uniform vec2 uvMax;
 in vec2 UVs;
 
 void main()
 {
-    FragColor = texture(screen,UVs);
+    FragColor = texture(screen,min(uvOffset + UVs*uvScale, uvMax));
 }
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "autotune.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gpu_bench.h"
+
+#define AUTOTUNE_DEPTH 1000.0
+#define AUTOTUNE_REPEATS 5
+#define MAX_LINE 512
+#define MAX_ENTRIES 32
+
+static const WorkgroupSize CANDIDATES[] = {
+    {4, 4}, {8, 4}, {8, 8}, {16, 8}, {16, 16}, {32, 8}, {32, 16}, {32, 32},
+    {32, 1}, {64, 1}, {128, 1}, {256, 1}, {512, 1}
+};
+#define CANDIDATE_COUNT (int)(sizeof(CANDIDATES)/sizeof(CANDIDATES[0]))
+
+// "x y renderer" per line
+static int parseLine(const char* line, WorkgroupSize* size, const char** renderer) {
+    int consumed = 0;
+    if (sscanf(line, "%d %d %n", &size->x, &size->y, &consumed) != 2) return 0;
+    if (size->x <= 0 || size->y <= 0) return 0;
+    *renderer = line + consumed;
+    return 1;
+}
+
+static void stripNewline(char* line) {
+    line[strcspn(line, "\r\n")] = '\0';
+}
+
+int loadWorkgroupSize(const char* path, const char* renderer, WorkgroupSize* out) {
+    FILE* fp = fopen(path, "r");
+    if (!fp) return 0;
+
+    char line[MAX_LINE];
+    int found = 0;
+    while (!found && fgets(line, sizeof(line), fp)) {
+        stripNewline(line);
+        WorkgroupSize size;
+        const char* name;
+        if (parseLine(line, &size, &name) && strcmp(name, renderer) == 0) {
+            *out = size;
+            found = 1;
+        }
+    }
+    fclose(fp);
+    return found;
+}
+
+int saveWorkgroupSize(const char* path, const char* renderer, WorkgroupSize size) {
+    // keep the results of the other renderers
+    char lines[MAX_ENTRIES][MAX_LINE];
+    int count = 0;
+    FILE* fp = fopen(path, "r");
+    if (fp) {
+        while (count < MAX_ENTRIES && fgets(lines[count], MAX_LINE, fp)) {
+            stripNewline(lines[count]);
+            WorkgroupSize old;
+            const char* name;
+            if (parseLine(lines[count], &old, &name) && strcmp(name, renderer) != 0) count++;
+        }
+        fclose(fp);
+    }
+
+    fp = fopen(path, "w");
+    if (!fp) return 0;
+    for (int i = 0; i < count; i++) fprintf(fp, "%s\n", lines[i]);
+    fprintf(fp, "%d %d %s\n", size.x, size.y, renderer);
+    return fclose(fp) == 0;
+}
+
+WorkgroupSize autotuneWorkgroup(VariantCache* cache, int width, int height, OutputFormat output) {
+    GLint maxInvocations = 0;
+    GLint maxSize[2] = {0, 0};
+    glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &maxInvocations);
+    glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 0, &maxSize[0]);
+    glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 1, &maxSize[1]);
+
+    // reference view: the whole set, where the interior dominates the cost
+    KernelVariant variant = chooseVariant(-2.5, -1.5, 1.0, 1.5, 3.5/width,
+                                          AUTOTUNE_DEPTH, COLOUR_PALETTE, output);
+    WorkgroupSize best = {DEFAULT_LOCAL_X, DEFAULT_LOCAL_Y};
+    GLuint64 bestTime = 0;
+
+    GpuTiming timing;
+    initGpuTiming(&timing);
+    for (int c = 0; c < CANDIDATE_COUNT; c++) {
+        WorkgroupSize size = CANDIDATES[c];
+        if (size.x*size.y > maxInvocations || size.x > maxSize[0] || size.y > maxSize[1]) continue;
+
+        variant.localX = size.x;
+        variant.localY = size.y;
+        GLuint program = getVariantProgram(cache, &variant);
+        if (!program) continue;
+
+        glUseProgram(program);
+        glUniform1f(0, AUTOTUNE_DEPTH);
+        setSectionUniform(&variant, 0.0, 0.0, 1.0, 1.0);
+        glUniform4f(2, -1.0f, -1.0f, -1.0f, -1.0f);
+        glUniform2i(3, width, height);
+
+        // first dispatch warms up the driver, the rest are timed
+        GLuint64 fastest = 0;
+        for (int r = 0; r <= AUTOTUNE_REPEATS; r++) {
+            beginGpuTiming(&timing);
+            dispatchVariant(&variant, width, height);
+            GLuint64 elapsed = endGpuTiming(&timing);
+            if (r > 0 && (r == 1 || elapsed < fastest)) fastest = elapsed;
+        }
+        printf("autotune %3dx%-3d %8.3f ms\n", size.x, size.y, fastest/1e6);
+
+        if (bestTime == 0 || fastest < bestTime) {
+            bestTime = fastest;
+            best = size;
+        }
+    }
+    destroyGpuTiming(&timing);
+
+    // only the winner is rendered with from here on
+    for (int c = 0; c < CANDIDATE_COUNT; c++) {
+        if (CANDIDATES[c].x == best.x && CANDIDATES[c].y == best.y) continue;
+        variant.localX = CANDIDATES[c].x;
+        variant.localY = CANDIDATES[c].y;
+        releaseVariant(cache, &variant);
+    }
+    return best;
+}
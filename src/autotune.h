@@ -0,0 +1,21 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include "shader_variant.h"
+
+#define AUTOTUNE_PATH "autotune.txt"
+
+typedef struct {
+    int x;
+    int y;
+} WorkgroupSize;
+
+// looks up the persisted size for renderer, returns 0 if there is none
+int loadWorkgroupSize(const char* path, const char* renderer, WorkgroupSize* out);
+int saveWorkgroupSize(const char* path, const char* renderer, WorkgroupSize size);
+
+// times every candidate local size on a reference view rendered into the
+// image bound at unit 0 (width x height, in format output) and returns the fastest
+WorkgroupSize autotuneWorkgroup(VariantCache* cache, int width, int height, OutputFormat output);
+
+#endif
@@ -0,0 +1,144 @@
+#include "capture.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "image_io.h"
+#include "trace.h"
+
+// host memory the CPU reads from; coherent so a signalled fence is all it takes
+#define CAPTURE_STORAGE_FLAGS (GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT | GL_CLIENT_STORAGE_BIT)
+#define CAPTURE_MAP_FLAGS (GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT)
+
+static int writeCapture(const CaptureSlot* slot) {
+    double start = traceBegin();
+    int ok = imageFormatFromPath(slot->path) == IMAGE_PNG
+        ? writePNG(slot->path, slot->width, slot->height, slot->mapped, NULL)
+        : writePPM(slot->path, slot->width, slot->height, slot->mapped, NULL);
+    traceEnd("encode", start);
+    return ok;
+}
+
+static void* encoderMain(void* arg) {
+    FrameCapture* c = arg;
+    traceThreadName("capture encoder");
+    pthread_mutex_lock(&c->lock);
+    for (;;) {
+        while (c->queueCount == 0 && !c->quit) pthread_cond_wait(&c->wake, &c->lock);
+        if (c->queueCount == 0) break;
+        CaptureSlot* slot = &c->slots[c->queue[0]];
+        pthread_mutex_unlock(&c->lock);
+
+        int ok = writeCapture(slot);
+
+        pthread_mutex_lock(&c->lock);
+        if (!ok) {
+            c->failed++;
+            fprintf(stderr, "Failed to write %s\n", slot->path);
+        }
+        memmove(&c->queue[0], &c->queue[1], (size_t)(c->queueCount - 1) * sizeof(int));
+        c->queueCount--;
+        slot->state = CAPTURE_FREE;
+    }
+    pthread_mutex_unlock(&c->lock);
+    return NULL;
+}
+
+int initFrameCapture(FrameCapture* c) {
+    memset(c, 0, sizeof(*c));
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->wake, NULL);
+    if (pthread_create(&c->encoder, NULL, encoderMain, c) != 0) {
+        pthread_cond_destroy(&c->wake);
+        pthread_mutex_destroy(&c->lock);
+        return 0;
+    }
+    return 1;
+}
+
+// only called on a free slot, the encoder is not reading the old mapping
+static int reserveSlot(CaptureSlot* slot, size_t size) {
+    if (slot->capacity >= size) return 1;
+    if (slot->pbo) {
+        glUnmapNamedBuffer(slot->pbo);
+        glDeleteBuffers(1, &slot->pbo);
+    }
+    glCreateBuffers(1, &slot->pbo);
+    glNamedBufferStorage(slot->pbo, (GLsizeiptr)size, NULL, CAPTURE_STORAGE_FLAGS);
+    slot->mapped = glMapNamedBufferRange(slot->pbo, 0, (GLsizeiptr)size, CAPTURE_MAP_FLAGS);
+    slot->capacity = slot->mapped ? size : 0;
+    return slot->mapped != NULL;
+}
+
+int captureTarget(FrameCapture* c, const RenderTarget* target, const char* path) {
+    CaptureSlot* slot = &c->slots[c->next];
+    pthread_mutex_lock(&c->lock);
+    CaptureState state = slot->state;
+    pthread_mutex_unlock(&c->lock);
+    if (state != CAPTURE_FREE) {
+        c->dropped++;
+        return 0;
+    }
+
+    size_t size = (size_t)target->width * target->height * 3;
+    if (!reserveSlot(slot, size)) {
+        c->failed++;
+        return 0;
+    }
+    slot->width = target->width;
+    slot->height = target->height;
+    snprintf(slot->path, sizeof(slot->path), "%s", path);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTextureSubImage(target->texture, 0, 0, 0, 0, target->width, target->height, 1,
+                         GL_RGB, GL_UNSIGNED_BYTE, (GLsizei)size, NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot->state = CAPTURE_READING;
+
+    c->next = (c->next + 1) % CAPTURE_SLOTS;
+    c->captured++;
+    return 1;
+}
+
+void collectCaptures(FrameCapture* c, int wait) {
+    // oldest first, so frames reach the encoder in order
+    for (int i = 0; i < CAPTURE_SLOTS; i++) {
+        CaptureSlot* slot = &c->slots[(c->next + i) % CAPTURE_SLOTS];
+        // only the GL thread touches the fence, it is set while the slot is READING
+        if (!slot->fence) continue;
+        GLuint64 timeout = wait ? 1000000000 : 0;
+        GLenum status;
+        do {
+            status = glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+        } while (wait && status == GL_TIMEOUT_EXPIRED);
+        if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) break;
+        glDeleteSync(slot->fence);
+        slot->fence = 0;
+
+        pthread_mutex_lock(&c->lock);
+        slot->state = CAPTURE_ENCODING;
+        c->queue[c->queueCount++] = (int)(slot - c->slots);
+        pthread_cond_signal(&c->wake);
+        pthread_mutex_unlock(&c->lock);
+    }
+}
+
+void destroyFrameCapture(FrameCapture* c) {
+    collectCaptures(c, 1);
+    pthread_mutex_lock(&c->lock);
+    c->quit = 1;
+    pthread_cond_signal(&c->wake);
+    pthread_mutex_unlock(&c->lock);
+    pthread_join(c->encoder, NULL);
+    pthread_cond_destroy(&c->wake);
+    pthread_mutex_destroy(&c->lock);
+
+    for (int i = 0; i < CAPTURE_SLOTS; i++) {
+        CaptureSlot* slot = &c->slots[i];
+        if (!slot->pbo) continue;
+        glUnmapNamedBuffer(slot->pbo);
+        glDeleteBuffers(1, &slot->pbo);
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <pthread.h>
+#include <glad/glad.h>
+
+#include "render_target.h"
+
+// Frame capture without stalling the pipeline. A target is copied into one of
+// CAPTURE_SLOTS persistently mapped pixel buffers and fenced; a later frame
+// finds the fence signalled and hands the mapped pixels to an encoder thread,
+// which writes the file straight from the mapping. When every slot is still
+// in flight or being encoded the frame is dropped instead of waited for.
+
+#define CAPTURE_SLOTS 3
+#define CAPTURE_PATH_MAX 256
+
+// image stores have to be made visible to the readback with this barrier
+#define CAPTURE_BARRIER_BITS GL_TEXTURE_UPDATE_BARRIER_BIT
+
+typedef enum {
+    CAPTURE_FREE = 0,
+    CAPTURE_READING,    // GPU copy in flight, owned by the GL thread
+    CAPTURE_ENCODING    // queued or being written, owned by the encoder
+} CaptureState;
+
+typedef struct {
+    GLuint pbo;
+    unsigned char* mapped;
+    size_t capacity;
+    GLsync fence;
+    int width;
+    int height;
+    CaptureState state;
+    char path[CAPTURE_PATH_MAX];
+} CaptureSlot;
+
+typedef struct {
+    CaptureSlot slots[CAPTURE_SLOTS];
+    int next;
+    // slots waiting for the encoder, oldest first
+    int queue[CAPTURE_SLOTS];
+    int queueCount;
+    int quit;
+    pthread_t encoder;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    unsigned long long captured;
+    unsigned long long dropped;
+    unsigned long long failed;
+} FrameCapture;
+
+// returns 0 if the encoder thread could not be started
+int initFrameCapture(FrameCapture* c);
+// queues a readback of the rendered part of target, written to path (.ppm or
+// .png) once it lands; returns 0 if the frame was dropped
+int captureTarget(FrameCapture* c, const RenderTarget* target, const char* path);
+// hands finished readbacks to the encoder, waiting for them when wait is set
+void collectCaptures(FrameCapture* c, int wait);
+// finishes every pending capture, then stops the encoder
+void destroyFrameCapture(FrameCapture* c);
+
+#endif
@@ -0,0 +1,531 @@
+#include "cpu_render.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+typedef struct {
+    const MandelView* view;
+    int width;
+    int height;
+    int tilesX;
+    int tileCount;
+    MandelIterateFn iterate;
+    int* iterOut;
+    atomic_int next;
+} TileJob;
+
+// tiles of a TileCache that missed, rendered into their cache buffers
+typedef struct {
+    const TileKey* keys;
+    int** buffers;
+    int count;
+    MandelIterateFn iterate;
+    atomic_int next;
+} CacheFillJob;
+
+// tiles of a frame that takes what it can from a reference frame
+typedef struct {
+    TileJob tiles;
+    const MandelView* referenceView;
+    const int* reference;
+    atomic_llong reused;
+} ReuseJob;
+
+// tiles of an exponential map, CPU_TILE_SIZE square in samples
+typedef struct {
+    const ExpMap* map;
+    int depth;
+    int row0;
+    int rows;
+    int tilesX;
+    int tileCount;
+    MandelIterateFn iterate;
+    int* iterOut;
+    atomic_int next;
+} ExpMapJob;
+
+// tiles of a frame resampled from an exponential map
+typedef struct {
+    TileJob tiles;
+    const ExpMap* map;
+    const int* strip;
+    int row0;
+    int rows;
+    double discPixels;
+    atomic_llong iterated;
+} ResampleJob;
+
+typedef struct {
+    void (*work)(void* job);
+    void* job;
+} Worker;
+
+static void renderTiles(void* arg) {
+    TileJob* job = arg;
+    for (;;) {
+        int tile = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed);
+        if (tile >= job->tileCount) break;
+        int x0 = tile % job->tilesX * CPU_TILE_SIZE;
+        int y0 = tile / job->tilesX * CPU_TILE_SIZE;
+        int x1 = x0 + CPU_TILE_SIZE < job->width ? x0 + CPU_TILE_SIZE : job->width;
+        int y1 = y0 + CPU_TILE_SIZE < job->height ? y0 + CPU_TILE_SIZE : job->height;
+        mandelRenderRegion(job->view, job->width, job->height, x0, y0, x1, y1,
+                           job->iterate, job->iterOut);
+    }
+}
+
+// the reference sample nearest to c along one axis, -1 unless it is within
+// half of one of the frame's pixels
+static int reusableSample(double c, double referenceOrigin, double referenceSpan, double span, int pixels) {
+    double r = (c - referenceOrigin)/referenceSpan*pixels;
+    double nearest = floor(r + 0.5);
+    if (fabs(r - nearest)*referenceSpan/span > 0.5 || nearest < 0.0 || nearest >= pixels) return -1;
+    return (int)nearest;
+}
+
+static void reuseTiles(void* arg) {
+    ReuseJob* job = arg;
+    const MandelView* view = job->tiles.view;
+    const MandelView* ref = job->referenceView;
+    int width = job->tiles.width;
+    int height = job->tiles.height;
+    double spanY = view->span * (double)height / (double)width;
+    double refSpanY = ref->span * (double)height / (double)width;
+    double left = view->cx - 0.5*view->span;
+    double bottom = view->cy - 0.5*spanY;
+    double refLeft = ref->cx - 0.5*ref->span;
+    double refBottom = ref->cy - 0.5*refSpanY;
+    for (;;) {
+        int tile = atomic_fetch_add_explicit(&job->tiles.next, 1, memory_order_relaxed);
+        if (tile >= job->tiles.tileCount) break;
+        double traceStart = traceBegin();
+        int x0 = tile % job->tiles.tilesX * CPU_TILE_SIZE;
+        int y0 = tile / job->tiles.tilesX * CPU_TILE_SIZE;
+        int x1 = x0 + CPU_TILE_SIZE < width ? x0 + CPU_TILE_SIZE : width;
+        int y1 = y0 + CPU_TILE_SIZE < height ? y0 + CPU_TILE_SIZE : height;
+        long long reused = 0;
+        for (int y = y0; y < y1; y++) {
+            double cy = bottom + spanY * ((double)y / (double)height);
+            int ry = reusableSample(cy, refBottom, refSpanY, spanY, height);
+            for (int x = x0; x < x1; x++) {
+                double cx = left + view->span * ((double)x / (double)width);
+                int rx = ry < 0 ? -1 : reusableSample(cx, refLeft, ref->span, view->span, width);
+                int* out = &job->tiles.iterOut[(size_t)y*width + x];
+                if (rx >= 0) {
+                    *out = job->reference[(size_t)ry*width + rx];
+                    reused++;
+                } else {
+                    *out = job->tiles.iterate(cx, cy, view->depth);
+                }
+            }
+        }
+        atomic_fetch_add_explicit(&job->reused, reused, memory_order_relaxed);
+        traceEnd("reuse tile", traceStart);
+    }
+}
+
+static void renderExpMapTiles(void* arg) {
+    ExpMapJob* job = arg;
+    const ExpMap* map = job->map;
+    for (;;) {
+        int tile = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed);
+        if (tile >= job->tileCount) break;
+        double traceStart = traceBegin();
+        int a0 = tile % job->tilesX * CPU_TILE_SIZE;
+        int k0 = tile / job->tilesX * CPU_TILE_SIZE;
+        int a1 = a0 + CPU_TILE_SIZE < map->columns ? a0 + CPU_TILE_SIZE : map->columns;
+        int k1 = k0 + CPU_TILE_SIZE < job->rows ? k0 + CPU_TILE_SIZE : job->rows;
+        for (int k = k0; k < k1; k++) {
+            double radius = exp(map->logRadius - (job->row0 + k)*map->step);
+            for (int a = a0; a < a1; a++) {
+                double angle = a*map->step;
+                job->iterOut[(size_t)k*map->columns + a] =
+                    job->iterate(map->cx + radius*cos(angle), map->cy + radius*sin(angle), job->depth);
+            }
+        }
+        traceEnd("exp map tile", traceStart);
+    }
+}
+
+static void resampleTiles(void* arg) {
+    ResampleJob* job = arg;
+    const MandelView* view = job->tiles.view;
+    const ExpMap* map = job->map;
+    int width = job->tiles.width;
+    int height = job->tiles.height;
+    double spanY = view->span * (double)height / (double)width;
+    double left = view->cx - 0.5*view->span;
+    double bottom = view->cy - 0.5*spanY;
+    double disc = job->discPixels * view->span / (double)width;
+    for (;;) {
+        int tile = atomic_fetch_add_explicit(&job->tiles.next, 1, memory_order_relaxed);
+        if (tile >= job->tiles.tileCount) break;
+        double traceStart = traceBegin();
+        int x0 = tile % job->tiles.tilesX * CPU_TILE_SIZE;
+        int y0 = tile / job->tiles.tilesX * CPU_TILE_SIZE;
+        int x1 = x0 + CPU_TILE_SIZE < width ? x0 + CPU_TILE_SIZE : width;
+        int y1 = y0 + CPU_TILE_SIZE < height ? y0 + CPU_TILE_SIZE : height;
+        long long iterated = 0;
+        for (int y = y0; y < y1; y++) {
+            double cy = bottom + spanY * ((double)y / (double)height);
+            for (int x = x0; x < x1; x++) {
+                double cx = left + view->span * ((double)x / (double)width);
+                double dx = cx - map->cx;
+                double dy = cy - map->cy;
+                double radius = sqrt(dx*dx + dy*dy);
+                int* out = &job->tiles.iterOut[(size_t)y*width + x];
+                long long k = radius < disc ? -1 :
+                    (long long)floor((map->logRadius - log(radius))/map->step + 0.5) - job->row0;
+                if (k < 0 || k >= job->rows) {
+                    *out = job->tiles.iterate(cx, cy, view->depth);
+                    iterated++;
+                    continue;
+                }
+                long long a = (long long)floor(atan2(dy, dx)/map->step + 0.5);
+                if (a < 0) a += map->columns;
+                if (a >= map->columns) a -= map->columns;
+                *out = job->strip[(size_t)k*map->columns + a];
+            }
+        }
+        atomic_fetch_add_explicit(&job->iterated, iterated, memory_order_relaxed);
+        traceEnd("resample tile", traceStart);
+    }
+}
+
+static void fillCacheTiles(void* arg) {
+    CacheFillJob* job = arg;
+    for (;;) {
+        int i = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed);
+        if (i >= job->count) break;
+        const TileKey* key = &job->keys[i];
+        double span = tileSpan(key->level);
+        MandelView tile = {"tile", TILE_ROOT_X + (key->tx + 0.5)*span,
+                           TILE_ROOT_Y + (key->ty + 0.5)*span, span, key->depth};
+        mandelRenderRegion(&tile, TILE_SIZE, TILE_SIZE, 0, 0, TILE_SIZE, TILE_SIZE,
+                           job->iterate, job->buffers[i]);
+    }
+}
+
+static void* workerMain(void* arg) {
+    Worker* worker = arg;
+    traceThreadName("cpu render");
+    worker->work(worker->job);
+    return NULL;
+}
+
+// runs work on up to threads threads, the calling thread being one of them
+static int runWorkers(int threads, void (*work)(void* job), void* job) {
+    Worker worker = {work, job};
+    if (threads < 1) threads = 1;
+    pthread_t* workers = malloc((size_t)threads * sizeof(pthread_t));
+    if (!workers) threads = 1;
+    int started = 0;
+    for (; workers && started < threads - 1; started++) {
+        if (pthread_create(&workers[started], NULL, workerMain, &worker) != 0) break;
+    }
+    // the share of a worker that failed to start is taken by the others
+    work(job);
+    for (int i = 0; i < started; i++) pthread_join(workers[i], NULL);
+    free(workers);
+    return started + 1;
+}
+
+int cpuRenderView(const MandelView* view, int width, int height,
+                  MandelIterateFn iterate, int threads, int* iterOut) {
+    TileJob job;
+    job.view = view;
+    job.width = width;
+    job.height = height;
+    job.tilesX = (width + CPU_TILE_SIZE - 1) / CPU_TILE_SIZE;
+    job.tileCount = job.tilesX * ((height + CPU_TILE_SIZE - 1) / CPU_TILE_SIZE);
+    job.iterate = iterate;
+    job.iterOut = iterOut;
+    atomic_init(&job.next, 0);
+
+    if (threads > job.tileCount) threads = job.tileCount;
+    return runWorkers(threads, renderTiles, &job);
+}
+
+int cpuRenderViewReusing(const MandelView* referenceView, const int* reference,
+                         const MandelView* view, int width, int height,
+                         MandelIterateFn iterate, int threads, int* iterOut, long long* reused) {
+    ReuseJob job;
+    job.tiles.view = view;
+    job.tiles.width = width;
+    job.tiles.height = height;
+    job.tiles.tilesX = (width + CPU_TILE_SIZE - 1) / CPU_TILE_SIZE;
+    job.tiles.tileCount = job.tiles.tilesX * ((height + CPU_TILE_SIZE - 1) / CPU_TILE_SIZE);
+    job.tiles.iterate = iterate;
+    job.tiles.iterOut = iterOut;
+    atomic_init(&job.tiles.next, 0);
+    job.referenceView = referenceView;
+    job.reference = reference;
+    atomic_init(&job.reused, 0);
+
+    if (threads > job.tiles.tileCount) threads = job.tiles.tileCount;
+    int workers = runWorkers(threads, reuseTiles, &job);
+    *reused = atomic_load(&job.reused);
+    return workers;
+}
+
+int cpuRenderExpMap(const ExpMap* map, int depth, int row0, int rows,
+                    MandelIterateFn iterate, int threads, int* iterOut) {
+    ExpMapJob job;
+    job.map = map;
+    job.depth = depth;
+    job.row0 = row0;
+    job.rows = rows;
+    job.tilesX = (map->columns + CPU_TILE_SIZE - 1) / CPU_TILE_SIZE;
+    job.tileCount = job.tilesX * ((rows + CPU_TILE_SIZE - 1) / CPU_TILE_SIZE);
+    job.iterate = iterate;
+    job.iterOut = iterOut;
+    atomic_init(&job.next, 0);
+
+    if (threads > job.tileCount) threads = job.tileCount;
+    return runWorkers(threads, renderExpMapTiles, &job);
+}
+
+int cpuResampleExpMap(const ExpMap* map, const int* strip, int row0, int rows,
+                      const MandelView* view, int width, int height, double discPixels,
+                      MandelIterateFn iterate, int threads, int* iterOut, long long* iterated) {
+    ResampleJob job;
+    job.tiles.view = view;
+    job.tiles.width = width;
+    job.tiles.height = height;
+    job.tiles.tilesX = (width + CPU_TILE_SIZE - 1) / CPU_TILE_SIZE;
+    job.tiles.tileCount = job.tiles.tilesX * ((height + CPU_TILE_SIZE - 1) / CPU_TILE_SIZE);
+    job.tiles.iterate = iterate;
+    job.tiles.iterOut = iterOut;
+    atomic_init(&job.tiles.next, 0);
+    job.map = map;
+    job.strip = strip;
+    job.row0 = row0;
+    job.rows = rows;
+    job.discPixels = discPixels;
+    atomic_init(&job.iterated, 0);
+
+    if (threads > job.tiles.tileCount) threads = job.tiles.tileCount;
+    int workers = runWorkers(threads, resampleTiles, &job);
+    *iterated = atomic_load(&job.iterated);
+    return workers;
+}
+
+// index of the tile sample nearest to c along one axis
+static long long nearestSample(double c, double origin, double pixel) {
+    return (long long)floor((c - origin)/pixel + 0.5);
+}
+
+static long long floorDiv(long long a, long long b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+#define OFF_SAMPLE (-1)
+// pixels further from a tile sample than this are not meant to be on it
+#define ON_GRID_PIXELS 1e-6
+
+// where fillCacheTiles evaluates a sample, computed as it does
+static double tileSample(long long sample, double origin, int level) {
+    double span = tileSpan(level);
+    long long tile = floorDiv(sample, TILE_SIZE);
+    double first = origin + ((double)tile + 0.5)*span - 0.5*span;
+    return first + span * ((double)(sample - tile*TILE_SIZE) / (double)TILE_SIZE);
+}
+
+// the tile sample of each of count pixels along one axis, relative to the
+// first one's tile, or OFF_SAMPLE where rounding put the pixel a bit off it;
+// 0 unless every pixel is within ON_GRID_PIXELS of a sample
+static int onTileGrid(double start, double span, int count, double origin, int level, long long* samples) {
+    double pixel = tileSpan(level) / TILE_SIZE;
+    long long first = floorDiv(nearestSample(start, origin, pixel), TILE_SIZE)*TILE_SIZE;
+    for (int i = 0; i < count; i++) {
+        // the same mapping as mandelRenderRegion
+        double c = start + span * ((double)i / (double)count);
+        long long sample = nearestSample(c, origin, pixel);
+        double at = tileSample(sample, origin, level);
+        if (fabs(c - at) > ON_GRID_PIXELS*pixel) return 0;
+        samples[i] = at == c ? sample - first : OFF_SAMPLE;
+    }
+    return 1;
+}
+
+// pixels exactly at a tile sample are copied, the rest iterated here
+static void compositeTiles(const MandelView* view, int width, int height, int tilesX, const int* const* grid,
+                           const long long* columns, const long long* rows, MandelIterateFn iterate, int* iterOut) {
+    double traceStart = traceBegin();
+    double spanY = view->span * (double)height / (double)width;
+    double left = view->cx - 0.5*view->span;
+    double bottom = view->cy - 0.5*spanY;
+    for (int y = 0; y < height; y++) {
+        double cy = bottom + spanY * ((double)y / (double)height);
+        int* out = &iterOut[(size_t)y*width];
+        if (rows[y] == OFF_SAMPLE) {
+            for (int x = 0; x < width; x++) {
+                out[x] = iterate(left + view->span * ((double)x / (double)width), cy, view->depth);
+            }
+            continue;
+        }
+        const int* const* tileRow = &grid[(rows[y] / TILE_SIZE)*tilesX];
+        const int sampleRow = (int)(rows[y] % TILE_SIZE)*TILE_SIZE;
+        for (int x = 0; x < width; x++) {
+            if (columns[x] == OFF_SAMPLE) {
+                out[x] = iterate(left + view->span * ((double)x / (double)width), cy, view->depth);
+            } else {
+                out[x] = tileRow[columns[x] / TILE_SIZE][sampleRow + columns[x] % TILE_SIZE];
+            }
+        }
+    }
+    traceEnd("tile composite", traceStart);
+}
+
+static int fillTiles(const TileKey* keys, int** buffers, int count,
+                     MandelIterateFn iterate, int threads) {
+    CacheFillJob job;
+    job.keys = keys;
+    job.buffers = buffers;
+    job.count = count;
+    job.iterate = iterate;
+    atomic_init(&job.next, 0);
+    return runWorkers(threads < count ? threads : count, fillCacheTiles, &job);
+}
+
+int cpuRenderViewCached(TileCache* cache, TileStore* store, const MandelView* view,
+                        int width, int height, MandelIterateFn iterate, int threads,
+                        int* iterOut, TileUsage* usage) {
+    double spanY = view->span * (double)height / (double)width;
+    double left = view->cx - 0.5*view->span;
+    double bottom = view->cy - 0.5*spanY;
+    int level = tileLevelForPixel(view->span / width);
+    memset(usage, 0, sizeof(*usage));
+    usage->level = level;
+
+    // tiles are only used where they hold exactly what the view would compute,
+    // a view whose pixels fall between tile samples is rendered directly
+    long long* columns = malloc((size_t)width * sizeof(long long));
+    long long* rows = malloc((size_t)height * sizeof(long long));
+    if (!columns || !rows ||
+        !onTileGrid(left, view->span, width, TILE_ROOT_X, level, columns) ||
+        !onTileGrid(bottom, spanY, height, TILE_ROOT_Y, level, rows)) {
+        free(columns);
+        free(rows);
+        usage->offGrid = columns && rows;
+        return cpuRenderView(view, width, height, iterate, threads, iterOut);
+    }
+    double pixel = tileSpan(level) / TILE_SIZE;
+    long long tx0 = floorDiv(nearestSample(left, TILE_ROOT_X, pixel), TILE_SIZE);
+    long long ty0 = floorDiv(nearestSample(bottom, TILE_ROOT_Y, pixel), TILE_SIZE);
+    // the last pixel is at most a rounding error off its sample
+    long long lastColumn = nearestSample(left + view->span*((double)(width-1)/width), TILE_ROOT_X, pixel);
+    long long lastRow = nearestSample(bottom + spanY*((double)(height-1)/height), TILE_ROOT_Y, pixel);
+    int tilesX = (int)(floorDiv(lastColumn, TILE_SIZE) - tx0 + 1);
+    int tilesY = (int)(floorDiv(lastRow, TILE_SIZE) - ty0 + 1);
+    int needed = tilesX * tilesY;
+
+    // a view that needs more tiles than fit would evict its own tiles
+    if (cache && needed > cache->capacity) cache = NULL;
+    if (!cache && !store) {
+        free(columns);
+        free(rows);
+        return cpuRenderView(view, width, height, iterate, threads, iterOut);
+    }
+
+    const int** grid = malloc((size_t)needed * sizeof(int*));
+    TileKey* keys = malloc((size_t)needed * sizeof(TileKey));
+    int** buffers = malloc((size_t)needed * sizeof(int*));
+    int* cells = malloc((size_t)needed * sizeof(int));
+    StoredTile* stored = malloc((size_t)needed * sizeof(StoredTile));
+    int* storedCells = malloc((size_t)needed * sizeof(int));
+    // tiles that have no cache buffer, one slot per tile of the view at most
+    int* scratch = NULL;
+    int scratchUsed = 0;
+    int ok = grid && keys && buffers && cells && stored && storedCells;
+
+    // memory first, then the store (read in place), the rest is rendered
+    int missing = 0;
+    for (int j = 0; ok && j < tilesY; j++) {
+        for (int i = 0; ok && i < tilesX; i++) {
+            TileKey key = {level, tx0 + i, ty0 + j, view->depth, TILE_FORMULA_MANDELBROT, 1};
+            const int* iters = cache ? findTile(cache, &key) : NULL;
+            if (iters) {
+                usage->cached++;
+            } else if (store && findStoredTile(store, &key, &stored[usage->stored])) {
+                iters = stored[usage->stored].iters;
+                storedCells[usage->stored++] = j*tilesX + i;
+            } else {
+                int* buffer = cache ? insertTile(cache, &key) : NULL;
+                if (cache && !buffer) ok = 0;
+                keys[missing] = key;
+                buffers[missing] = buffer;
+                cells[missing++] = j*tilesX + i;
+            }
+            grid[j*tilesX + i] = iters;
+        }
+    }
+
+    int workers = 1;
+    if (!ok) {
+        // the tiles already inserted into the cache still have to be filled
+        int fill = 0;
+        while (fill < missing && buffers[fill]) fill++;
+        if (fill > 0) fillTiles(keys, buffers, fill, iterate, threads);
+    }
+    int rendered = 0;
+    while (ok) {
+        if (missing > rendered) {
+            for (int m = rendered; ok && m < missing; m++) {
+                if (!buffers[m]) {
+                    if (!scratch) scratch = malloc((size_t)needed * TILE_BYTES);
+                    if (!scratch) ok = 0;
+                    else buffers[m] = scratch + (size_t)scratchUsed++ * TILE_SIZE * TILE_SIZE;
+                }
+                grid[cells[m]] = buffers[m];
+            }
+            if (!ok) break;
+            workers = fillTiles(&keys[rendered], &buffers[rendered], missing - rendered, iterate, threads);
+            rendered = missing;
+        }
+        compositeTiles(view, width, height, tilesX, grid, columns, rows, iterate, iterOut);
+
+        // a stored tile that another process rewrote while it was read is
+        // rendered here after all, and the view composited again
+        int kept = 0;
+        for (int t = 0; t < usage->stored; t++) {
+            if (tileStillValid(store, &stored[t])) {
+                stored[kept] = stored[t];
+                storedCells[kept++] = storedCells[t];
+            } else {
+                int cell = storedCells[t];
+                keys[missing] = (TileKey){level, tx0 + cell % tilesX, ty0 + cell / tilesX,
+                                          view->depth, TILE_FORMULA_MANDELBROT, 1};
+                buffers[missing] = NULL;
+                cells[missing++] = cell;
+            }
+        }
+        if (kept == usage->stored) break;
+        usage->stored = kept;
+    }
+    // only now, storing earlier could evict a tile this view is still reading
+    if (ok && store) {
+        for (int m = 0; m < rendered; m++) storeTile(store, &keys[m], buffers[m]);
+    }
+
+    free(grid);
+    free(keys);
+    free(buffers);
+    free(cells);
+    free(stored);
+    free(storedCells);
+    free(columns);
+    free(rows);
+    free(scratch);
+    if (!ok) {
+        memset(usage, 0, sizeof(*usage));
+        return cpuRenderView(view, width, height, iterate, threads, iterOut);
+    }
+    usage->needed = needed;
+    return workers;
+}
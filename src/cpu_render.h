@@ -0,0 +1,78 @@
+#ifndef CPU_RENDER_H
+#define CPU_RENDER_H
+
+#include "mandel.h"
+#include "tile_cache.h"
+#include "tile_store.h"
+
+// Multithreaded CPU backend. The image is cut into CPU_TILE_SIZE squares that
+// the threads take from a shared counter, so a slow tile near the set does
+// not hold up a thread that was handed a fixed strip.
+
+#define CPU_TILE_SIZE 64
+
+// renders the whole width x height view into iterOut with up to threads workers,
+// the calling thread being one of them; returns how many workers rendered
+int cpuRenderView(const MandelView* view, int width, int height,
+                  MandelIterateFn iterate, int threads, int* iterOut);
+
+// like cpuRenderView, but pixels that have a sample of reference (a full
+// render of referenceView at the same size and depth) within half a pixel of
+// their own take its iteration count instead of iterating; *reused gets how
+// many did
+int cpuRenderViewReusing(const MandelView* referenceView, const int* reference,
+                         const MandelView* view, int width, int height,
+                         MandelIterateFn iterate, int threads, int* iterOut, long long* reused);
+
+// An exponential map: a strip of samples around (cx, cy) in log-polar
+// coordinates, column a at angle a*step and row k at radius
+// exp(logRadius - k*step). Rows and columns are the same step apart, so a
+// sample covers about as many pixels at every radius, and every frame of a
+// zoom into the centre is a run of consecutive rows.
+typedef struct {
+    double cx;
+    double cy;
+    // of row 0, the outermost
+    double logRadius;
+    double step;
+    // 2 pi / step
+    int columns;
+} ExpMap;
+
+// renders rows [row0, row0 + rows) of map, columns per row, into iterOut
+int cpuRenderExpMap(const ExpMap* map, int depth, int row0, int rows,
+                    MandelIterateFn iterate, int threads, int* iterOut);
+
+// fills iterOut with a width x height render of view, centred on the map,
+// from the nearest sample of strip (rows [row0, row0 + rows) of map); pixels
+// within discPixels of the centre, or beyond the strip, are iterated and
+// counted in *iterated
+int cpuResampleExpMap(const ExpMap* map, const int* strip, int row0, int rows,
+                      const MandelView* view, int width, int height, double discPixels,
+                      MandelIterateFn iterate, int threads, int* iterOut, long long* iterated);
+
+typedef struct {
+    // tiles covering the view, 0 when it bypassed the caches
+    int needed;
+    // of those, how many were in memory and how many in the store
+    int cached;
+    int stored;
+    int level;
+    // the view's pixels fall between tile samples, so it was rendered directly
+    int offGrid;
+} TileUsage;
+
+// like cpuRenderView, but through a memory cache, a disk store or both (either
+// may be NULL): the tiles covering the view are looked up in memory, then in
+// the store, only the missing ones are rendered and written to both, and every
+// pixel is copied from its tile sample. Only a view whose pixels are the
+// samples of one level goes through the tiles, and a pixel that rounding put
+// off its sample is iterated, so the image is the same as cpuRenderView's; any
+// other view, one that needs more tiles than memory holds with no store, or
+// one whose stored tile another process rewrote while it was read, is
+// rendered directly.
+int cpuRenderViewCached(TileCache* cache, TileStore* store, const MandelView* view,
+                        int width, int height, MandelIterateFn iterate, int threads,
+                        int* iterOut, TileUsage* usage);
+
+#endif
@@ -0,0 +1,106 @@
+#include "egl_context.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <EGL/eglext.h>
+#include <glad/glad.h>
+
+// newest first; the kernels use nothing past 4.5 once their #version is lowered
+static const int GL_VERSIONS[][2] = {{4, 6}, {4, 5}};
+
+static int hasExtension(const char* extensions, const char* name) {
+    if (!extensions) return 0;
+    size_t length = strlen(name);
+    for (const char* p = strstr(extensions, name); p; p = strstr(p + 1, name)) {
+        if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0')) return 1;
+    }
+    return 0;
+}
+
+static EGLDisplay openDisplay(void) {
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay) {
+            EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+            if (display != EGL_NO_DISPLAY) return display;
+        }
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+// without EGL_KHR_no_config_context a context still needs some config
+static EGLConfig chooseConfig(EGLDisplay display) {
+    if (hasExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_no_config_context")) {
+        return EGL_NO_CONFIG_KHR;
+    }
+    static const EGLint attributes[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config = NULL;
+    EGLint count = 0;
+    if (!eglChooseConfig(display, attributes, &config, 1, &count) || count == 0) return NULL;
+    return config;
+}
+
+int createHeadlessContext(HeadlessContext* ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->display = openDisplay();
+    if (ctx->display == EGL_NO_DISPLAY || !eglInitialize(ctx->display, NULL, NULL)) {
+        fprintf(stderr, "Failed to initialise an EGL display\n");
+        return 0;
+    }
+    if (!hasExtension(eglQueryString(ctx->display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context")) {
+        fprintf(stderr, "EGL display cannot make a context current without a surface\n");
+        eglTerminate(ctx->display);
+        return 0;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        fprintf(stderr, "EGL has no desktop OpenGL\n");
+        eglTerminate(ctx->display);
+        return 0;
+    }
+
+    EGLConfig config = chooseConfig(ctx->display);
+    for (size_t i = 0; i < sizeof(GL_VERSIONS) / sizeof(GL_VERSIONS[0]); i++) {
+        const EGLint attributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, GL_VERSIONS[i][0],
+            EGL_CONTEXT_MINOR_VERSION, GL_VERSIONS[i][1],
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        ctx->context = eglCreateContext(ctx->display, config, EGL_NO_CONTEXT, attributes);
+        if (ctx->context != EGL_NO_CONTEXT) {
+            ctx->major = GL_VERSIONS[i][0];
+            ctx->minor = GL_VERSIONS[i][1];
+            break;
+        }
+    }
+    if (ctx->context == EGL_NO_CONTEXT) {
+        fprintf(stderr, "Failed to create a GL 4.5 or newer core context\n");
+        eglTerminate(ctx->display);
+        return 0;
+    }
+    if (!eglMakeCurrent(ctx->display, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx->context)
+        || !gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        fprintf(stderr, "Failed to load GL through EGL\n");
+        destroyHeadlessContext(ctx);
+        return 0;
+    }
+    return 1;
+}
+
+void destroyHeadlessContext(HeadlessContext* ctx) {
+    if (ctx->display == EGL_NO_DISPLAY) return;
+    eglMakeCurrent(ctx->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (ctx->context != EGL_NO_CONTEXT) eglDestroyContext(ctx->display, ctx->context);
+    eglTerminate(ctx->display);
+    ctx->display = EGL_NO_DISPLAY;
+    ctx->context = EGL_NO_CONTEXT;
+}
+
+int headlessGlslVersion(const HeadlessContext* ctx) {
+    return ctx->major * 100 + ctx->minor * 10;
+}
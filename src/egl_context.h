@@ -0,0 +1,26 @@
+#ifndef EGL_CONTEXT_H
+#define EGL_CONTEXT_H
+
+#include <EGL/egl.h>
+
+// GL context without a window or display server, for batch renders and CI.
+// Uses the Mesa surfaceless platform when the driver has it (llvmpipe
+// included) and the default display otherwise. Nothing is ever drawn to a
+// surface, results are read back from textures.
+
+typedef struct {
+    EGLDisplay display;
+    EGLContext context;
+    int major;
+    int minor;
+} HeadlessContext;
+
+// makes a 4.6 core context current, or 4.5 when the driver stops there, and
+// loads GL through glad; returns 0 and prints why on failure
+int createHeadlessContext(HeadlessContext* ctx);
+void destroyHeadlessContext(HeadlessContext* ctx);
+
+// the GLSL version of the context, e.g. 450
+int headlessGlslVersion(const HeadlessContext* ctx);
+
+#endif
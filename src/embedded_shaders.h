@@ -0,0 +1,15 @@
+#ifndef EMBEDDED_SHADERS_H
+#define EMBEDDED_SHADERS_H
+
+// The GLSL sources compiled into the binary. embedded_shaders.c is generated
+// from shader/*.glsl by tools/embed_shaders.c as part of the build.
+
+typedef struct {
+    const char* name;
+    const char* source;
+} EmbeddedShader;
+
+// source of the shader with this file name, NULL if it was not embedded
+const char* embeddedShader(const char* name);
+
+#endif
@@ -0,0 +1,117 @@
+#include "frame_histogram.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glad/glad.h>
+
+#define OVERLAY_BAR_WIDTH 3
+#define OVERLAY_HEIGHT 120
+#define OVERLAY_MARGIN 8
+
+void initFrameHistogram(FrameHistogram* h, double budgetMs) {
+    memset(h, 0, sizeof(*h));
+    h->budgetMs = budgetMs;
+}
+
+// below 2*FH_SUB_BUCKETS us every microsecond has a bucket; above, exponent e
+// holds [FH_SUB_BUCKETS << e, 2*FH_SUB_BUCKETS << e) in FH_SUB_BUCKETS steps
+static int bucketIndex(unsigned long long us) {
+    if (us < 2*FH_SUB_BUCKETS) return (int)us;
+    int exponent = 0;
+    while ((us >> exponent) >= 2*FH_SUB_BUCKETS) exponent++;
+    if (exponent >= FH_EXPONENTS) return FH_BUCKET_COUNT - 1;
+    int sub = (int)(us >> exponent) - FH_SUB_BUCKETS;
+    return 2*FH_SUB_BUCKETS + (exponent - 1)*FH_SUB_BUCKETS + sub;
+}
+
+static double bucketUpperMs(int index) {
+    if (index < 2*FH_SUB_BUCKETS) return (index + 1) / 1000.0;
+    int exponent = (index - 2*FH_SUB_BUCKETS) / FH_SUB_BUCKETS + 1;
+    int sub = (index - 2*FH_SUB_BUCKETS) % FH_SUB_BUCKETS;
+    return (double)((unsigned long long)(FH_SUB_BUCKETS + sub + 1) << exponent) / 1000.0;
+}
+
+void recordFrame(FrameHistogram* h, double ms) {
+    if (ms < 0.0) ms = 0.0;
+    h->counts[bucketIndex((unsigned long long)(ms * 1000.0))]++;
+    h->total++;
+    h->sumMs += ms;
+    if (ms > h->maxMs) h->maxMs = ms;
+    if (ms > h->budgetMs) h->overBudget++;
+    h->recent[h->recentNext] = ms;
+    h->recentNext = (h->recentNext + 1) % FH_RECENT;
+}
+
+double frameHistogramPercentile(const FrameHistogram* h, double p) {
+    if (h->total == 0) return 0.0;
+    unsigned long long rank = (unsigned long long)(p * h->total + 0.5);
+    if (rank < 1) rank = 1;
+    unsigned long long seen = 0;
+    for (int i = 0; i < FH_BUCKET_COUNT; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            double upper = bucketUpperMs(i);
+            return upper < h->maxMs ? upper : h->maxMs;
+        }
+    }
+    return h->maxMs;
+}
+
+void printFrameHistogram(const FrameHistogram* h) {
+    if (h->total == 0) return;
+    printf("frames %llu, avg %.3f ms, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+           h->total, h->sumMs / h->total,
+           frameHistogramPercentile(h, 0.50), frameHistogramPercentile(h, 0.95),
+           frameHistogramPercentile(h, 0.99), h->maxMs);
+    printf("over %.3f ms budget: %llu (%.2f%%)\n", h->budgetMs, h->overBudget,
+           100.0 * h->overBudget / h->total);
+}
+
+int writeFrameHistogram(const FrameHistogram* h, const char* path) {
+    FILE* fp = fopen(path, "w");
+    if (!fp) return 0;
+    fprintf(fp, "{\n  \"frames\": %llu,\n  \"budget_ms\": %.3f,\n  \"over_budget\": %llu,\n",
+            h->total, h->budgetMs, h->overBudget);
+    fprintf(fp, "  \"avg_ms\": %.4f,\n  \"p50_ms\": %.4f,\n  \"p95_ms\": %.4f,\n"
+                "  \"p99_ms\": %.4f,\n  \"max_ms\": %.4f,\n",
+            h->total ? h->sumMs / h->total : 0.0,
+            frameHistogramPercentile(h, 0.50), frameHistogramPercentile(h, 0.95),
+            frameHistogramPercentile(h, 0.99), h->maxMs);
+    fprintf(fp, "  \"buckets\": [");
+    int first = 1;
+    for (int i = 0; i < FH_BUCKET_COUNT; i++) {
+        if (!h->counts[i]) continue;
+        fprintf(fp, "%s\n    {\"upper_ms\": %.4f, \"count\": %llu}", first ? "" : ",",
+                bucketUpperMs(i), h->counts[i]);
+        first = 0;
+    }
+    fprintf(fp, "\n  ]\n}\n");
+    return fclose(fp) == 0;
+}
+
+static void fillRect(int x, int y, int w, int h, float r, float g, float b) {
+    glScissor(x, y, w, h);
+    glClearColor(r, g, b, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void drawFrameOverlay(const FrameHistogram* h, int fbWidth, int fbHeight) {
+    if (fbWidth < FH_RECENT*OVERLAY_BAR_WIDTH + 2*OVERLAY_MARGIN || fbHeight < OVERLAY_HEIGHT + 2*OVERLAY_MARGIN) return;
+    // twice the budget fills the graph
+    double msPerPixel = 2.0 * h->budgetMs / OVERLAY_HEIGHT;
+
+    glEnable(GL_SCISSOR_TEST);
+    fillRect(OVERLAY_MARGIN, OVERLAY_MARGIN, FH_RECENT*OVERLAY_BAR_WIDTH, OVERLAY_HEIGHT, 0.1f, 0.1f, 0.1f);
+    for (int i = 0; i < FH_RECENT; i++) {
+        double ms = h->recent[(h->recentNext + i) % FH_RECENT];
+        int height = (int)(ms / msPerPixel);
+        if (height > OVERLAY_HEIGHT) height = OVERLAY_HEIGHT;
+        if (height <= 0) continue;
+        int over = ms > h->budgetMs;
+        fillRect(OVERLAY_MARGIN + i*OVERLAY_BAR_WIDTH, OVERLAY_MARGIN, OVERLAY_BAR_WIDTH - 1, height,
+                 over ? 0.9f : 0.2f, over ? 0.2f : 0.8f, 0.2f);
+    }
+    fillRect(OVERLAY_MARGIN, OVERLAY_MARGIN + OVERLAY_HEIGHT/2, FH_RECENT*OVERLAY_BAR_WIDTH, 1, 0.0f, 0.0f, 0.0f);
+    glDisable(GL_SCISSOR_TEST);
+}
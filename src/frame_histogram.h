@@ -0,0 +1,39 @@
+#ifndef FRAME_HISTOGRAM_H
+#define FRAME_HISTOGRAM_H
+
+// HDR-histogram style record of every frame time. Buckets are a power of two
+// split into FH_SUB_BUCKETS linear steps, so any value from 1 us to over an
+// hour is kept to within 1/FH_SUB_BUCKETS of its size without storing the samples.
+
+#define FH_SUB_BUCKET_BITS 5
+#define FH_SUB_BUCKETS (1 << FH_SUB_BUCKET_BITS)
+#define FH_EXPONENTS 27
+#define FH_BUCKET_COUNT ((FH_EXPONENTS + 1) * FH_SUB_BUCKETS)
+#define FH_RECENT 128
+
+typedef struct {
+    unsigned long long counts[FH_BUCKET_COUNT];
+    unsigned long long total;
+    unsigned long long overBudget;
+    double budgetMs;
+    double maxMs;
+    double sumMs;
+    // the last FH_RECENT frame times for the overlay
+    double recent[FH_RECENT];
+    int recentNext;
+} FrameHistogram;
+
+void initFrameHistogram(FrameHistogram* h, double budgetMs);
+void recordFrame(FrameHistogram* h, double ms);
+// upper bound of the bucket holding the p-th fraction of frames, in ms
+double frameHistogramPercentile(const FrameHistogram* h, double p);
+
+void printFrameHistogram(const FrameHistogram* h);
+// JSON summary plus every non-empty bucket, returns 0 on failure
+int writeFrameHistogram(const FrameHistogram* h, const char* path);
+
+// draws the recent frame times as bars in the bottom-left of the bound
+// framebuffer, red over budget; the budget is the dark line
+void drawFrameOverlay(const FrameHistogram* h, int fbWidth, int fbHeight);
+
+#endif
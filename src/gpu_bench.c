@@ -0,0 +1,196 @@
+#include "gpu_bench.h"
+
+#include <stdio.h>
+
+#include "mandel.h"
+#include "platform.h"
+
+#define BENCH_REPEATS 10
+#define RING_BENCH_FRAMES 60
+
+void initGpuTiming(GpuTiming* t) {
+    glGenQueries(3, &t->elapsed);
+}
+
+void beginGpuTiming(GpuTiming* t) {
+    glQueryCounter(t->start, GL_TIMESTAMP);
+    glBeginQuery(GL_TIME_ELAPSED, t->elapsed);
+}
+
+// GL_TIME_ELAPSED is nested inside the timestamps so it can never be longer.
+// Some drivers (llvmpipe) report 0 around compute work and nonsense around
+// draws, the timestamps are used then
+GLuint64 endGpuTiming(GpuTiming* t) {
+    glEndQuery(GL_TIME_ELAPSED);
+    glQueryCounter(t->end, GL_TIMESTAMP);
+
+    GLuint64 elapsed = 0, start = 0, end = 0;
+    glGetQueryObjectui64v(t->elapsed, GL_QUERY_RESULT, &elapsed);
+    glGetQueryObjectui64v(t->start, GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(t->end, GL_QUERY_RESULT, &end);
+    if (end <= start) return elapsed;
+    if (elapsed > 1000 && elapsed <= end - start) return elapsed;
+    return end - start;
+}
+
+void destroyGpuTiming(GpuTiming* t) {
+    glDeleteQueries(3, &t->elapsed);
+}
+
+static double fastestMs(const GLuint64* times, int count) {
+    GLuint64 best = times[0];
+    for (int i = 1; i < count; i++) if (times[i] < best) best = times[i];
+    return best/1e6;
+}
+
+void benchOutputFormats(VariantCache* cache, GLuint presentProgram, GLuint quadVao,
+                        int width, int height) {
+    // stands in for the backbuffer so the present pass runs at full size
+    GLuint backbuffer, fbo;
+    glCreateRenderbuffers(1, &backbuffer);
+    glNamedRenderbufferStorage(backbuffer, GL_RGBA8, width, height);
+    glCreateFramebuffers(1, &fbo);
+    glNamedFramebufferRenderbuffer(fbo, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, backbuffer);
+
+    TargetPool pool;
+    initTargetPool(&pool);
+    GpuTiming timing;
+    initGpuTiming(&timing);
+    Presenter presenters[2];
+    initPresenter(&presenters[PRESENT_BLIT], PRESENT_BLIT, presentProgram, quadVao);
+    initPresenter(&presenters[PRESENT_QUAD], PRESENT_QUAD, presentProgram, quadVao);
+
+    // depth 1 makes the kernel bandwidth bound, depth 256 is a typical frame
+    const double depths[] = {1.0, 256.0};
+    printf("%dx%d, best of %d\n", width, height, BENCH_REPEATS);
+    printf("%-16s %6s %7s %10s %8s %8s %9s %7s\n",
+           "format", "depth", "MB", "kernel ms", "quad ms", "blit ms", "frame ms", "GB/s");
+    for (int f = 0; f < OUTPUT_FORMAT_COUNT; f++) {
+        OutputFormat output = (OutputFormat)f;
+        RenderTarget target = acquireTarget(&pool, width, height, outputInternalFormat(output));
+        glBindImageTexture(0, target.texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, target.format);
+
+        for (int d = 0; d < 2; d++) {
+            KernelVariant variant = chooseVariant(-2.5, -1.5, 1.0, 1.5, 3.5/width,
+                                                  depths[d], COLOUR_PALETTE, output);
+            GLuint program = getVariantProgram(cache, &variant);
+            if (!program) continue;
+
+            GLuint64 kernel[BENCH_REPEATS], quad[BENCH_REPEATS], blit[BENCH_REPEATS];
+            for (int r = 0; r < BENCH_REPEATS; r++) {
+                glUseProgram(program);
+                glUniform1f(0, (float)depths[d]);
+                setSectionUniform(&variant, 0.0, 0.0, 1.0, 1.0);
+                glUniform4f(2, -1.0f, -1.0f, -1.0f, -1.0f);
+                glUniform2i(3, width, height);
+                beginGpuTiming(&timing);
+                dispatchVariant(&variant, width, height);
+                kernel[r] = endGpuTiming(&timing);
+                glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+
+                beginGpuTiming(&timing);
+                presentTarget(&presenters[PRESENT_QUAD], &target, fbo, width, height);
+                quad[r] = endGpuTiming(&timing);
+                beginGpuTiming(&timing);
+                presentTarget(&presenters[PRESENT_BLIT], &target, fbo, width, height);
+                blit[r] = endGpuTiming(&timing);
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            }
+
+            // one imageStore and one texture fetch per pixel
+            double megabytes = 2.0 * width * height * outputBytesPerPixel(output) / 1e6;
+            double kernelMs = fastestMs(kernel, BENCH_REPEATS);
+            double quadMs = fastestMs(quad, BENCH_REPEATS);
+            double blitMs = fastestMs(blit, BENCH_REPEATS);
+            double frameMs = kernelMs + blitMs;
+            printf("%-16s %6.0f %7.1f %10.3f %8.3f %8.3f %9.3f %7.2f\n",
+                   outputLayoutName(output), depths[d], megabytes, kernelMs, quadMs, blitMs, frameMs,
+                   frameMs > 0.0 ? megabytes/frameMs : 0.0);
+        }
+        releaseTarget(&pool, &target);
+    }
+
+    destroyPresenter(&presenters[PRESENT_BLIT]);
+    destroyPresenter(&presenters[PRESENT_QUAD]);
+    destroyGpuTiming(&timing);
+    destroyTargetPool(&pool);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &backbuffer);
+}
+
+void benchRenderRing(VariantCache* cache, Presenter* presenter, int localX, int localY,
+                     int width, int height) {
+    GLuint backbuffer, fbo;
+    glCreateRenderbuffers(1, &backbuffer);
+    glNamedRenderbufferStorage(backbuffer, GL_RGBA8, width, height);
+    glCreateFramebuffers(1, &fbo);
+    glNamedFramebufferRenderbuffer(fbo, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, backbuffer);
+
+    const MandelView* view = &MANDEL_STANDARD_VIEWS[1];
+    double section[4];
+    mandelViewSection(view, width, height, section);
+    double halfX = 0.5*view->span;
+    double halfY = halfX * height / width;
+    KernelVariant variant = chooseVariant(view->cx - halfX, view->cy - halfY, view->cx + halfX,
+                                          view->cy + halfY, view->span / width, view->depth,
+                                          COLOUR_PALETTE, OUTPUT_RGBA8);
+    variant.localX = localX;
+    variant.localY = localY;
+    GLuint program = getVariantProgram(cache, &variant);
+    if (!program) return;
+
+    TargetPool pool;
+    initTargetPool(&pool);
+    GLuint endQuery;
+    glGenQueries(1, &endQuery);
+    GLbitfield barrier = presentBarrierBits(presenter);
+
+    printf("%s at depth %d, %dx%d, %d frames\n", view->name, view->depth, width, height, RING_BENCH_FRAMES);
+    printf("%4s %10s %10s\n", "ring", "ms/frame", "wait ms");
+    for (int size = 1; size <= RENDER_RING_MAX; size++) {
+        RenderRing ring;
+        initRenderRing(&ring, &pool, size, width, height, GL_RGBA8);
+        glFinish();
+        GLint64 start = 0;
+        glGetInteger64v(GL_TIMESTAMP, &start);
+        // CPU time blocked on the ring, what the overlap is meant to remove
+        double waited = 0.0;
+
+        // the same frame sequence as the main loop, minus the swap
+        for (int f = 0; f < RING_BENCH_FRAMES; f++) {
+            double waitStart = platformTime();
+            RenderTarget* target = beginRingFrame(&ring, &pool, width, height, GL_RGBA8);
+            waited += platformTime() - waitStart;
+            glBindImageTexture(0, target->texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, target->format);
+            RenderTarget* finished = ringPresentTarget(&ring);
+            if (ring.size > 1) {
+                glMemoryBarrier(barrier);
+                if (finished) presentTarget(presenter, finished, fbo, width, height);
+                fenceRingPresent(&ring);
+            }
+            glUseProgram(program);
+            glUniform1f(0, (float)view->depth);
+            setSectionUniform(&variant, section[0], section[1], section[2], section[3]);
+            glUniform4f(2, -1.0f, -1.0f, -1.0f, -1.0f);
+            glUniform2i(3, width, height);
+            dispatchVariant(&variant, width, height);
+            if (ring.size == 1) {
+                glMemoryBarrier(barrier);
+                presentTarget(presenter, finished, fbo, width, height);
+            }
+            endRingFrame(&ring);
+        }
+        glQueryCounter(endQuery, GL_TIMESTAMP);
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(endQuery, GL_QUERY_RESULT, &end);
+        printf("%4d %10.3f %10.3f\n", size, (double)(end - (GLuint64)start) / 1e6 / RING_BENCH_FRAMES,
+               waited * 1e3 / RING_BENCH_FRAMES);
+        destroyRenderRing(&ring, &pool);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteQueries(1, &endQuery);
+    destroyTargetPool(&pool);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &backbuffer);
+}
@@ -0,0 +1,33 @@
+#ifndef GPU_BENCH_H
+#define GPU_BENCH_H
+
+#include "shader_variant.h"
+#include "present.h"
+
+// Blocking GPU timing for benchmarks and the autotuner, not for use in the
+// frame loop.
+typedef struct {
+    GLuint elapsed;
+    GLuint start;
+    GLuint end;
+} GpuTiming;
+
+void initGpuTiming(GpuTiming* t);
+void beginGpuTiming(GpuTiming* t);
+// waits for the GPU and returns the nanoseconds since beginGpuTiming
+GLuint64 endGpuTiming(GpuTiming* t);
+void destroyGpuTiming(GpuTiming* t);
+
+// renders width x height in every output format and presents it with both
+// present paths (presentProgram drawing quadVao, and a blit), printing the
+// time and bytes moved per frame
+void benchOutputFormats(VariantCache* cache, GLuint presentProgram, GLuint quadVao,
+                        int width, int height);
+
+// renders a mid-depth view with rings of one to RENDER_RING_MAX targets,
+// presenting into an offscreen width x height framebuffer, and prints the
+// GPU time per frame
+void benchRenderRing(VariantCache* cache, Presenter* presenter, int localX, int localY,
+                     int width, int height);
+
+#endif
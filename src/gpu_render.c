@@ -0,0 +1,59 @@
+#include "gpu_render.h"
+
+#include <stdio.h>
+
+#include "platform.h"
+
+// the kernel marks the click position, this keeps it off the image
+#define NO_MOUSE (-1e4f)
+
+int gpuRenderView(VariantCache* cache, const MandelView* view, int width, int height,
+                  ColourMode colour, unsigned char* rgbOut, GpuRenderTimes* times) {
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    if (width > maxSize || height > maxSize) {
+        fprintf(stderr, "%dx%d is larger than the GL limit of %d\n", width, height, maxSize);
+        return 0;
+    }
+
+    double section[4];
+    mandelViewSection(view, width, height, section);
+    double spanY = view->span * (double)height / (double)width;
+    KernelVariant variant = chooseVariant(view->cx - 0.5*view->span, view->cy - 0.5*spanY,
+                                          view->cx + 0.5*view->span, view->cy + 0.5*spanY,
+                                          view->span / width, view->depth, colour, OUTPUT_RGBA8);
+    GLuint program = getVariantProgram(cache, &variant);
+    if (!program && variant.precision == PRECISION_DOUBLE) {
+        variant.precision = PRECISION_FLOAT;
+        program = getVariantProgram(cache, &variant);
+    }
+    if (!program) return 0;
+
+    GLuint texture;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureStorage2D(texture, 1, GL_RGBA8, width, height);
+    glBindImageTexture(0, texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+
+    double start = platformTime();
+    glUseProgram(program);
+    glUniform1f(0, (float)view->depth);
+    setSectionUniform(&variant, section[0], section[1], section[2], section[3]);
+    glUniform4f(2, NO_MOUSE, NO_MOUSE, NO_MOUSE, NO_MOUSE);
+    glUniform2i(3, width, height);
+    dispatchVariant(&variant, width, height);
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+    glFinish();
+    double dispatched = platformTime();
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTextureImage(texture, 0, GL_RGB, GL_UNSIGNED_BYTE,
+                      (GLsizei)((size_t)width * height * 3), rgbOut);
+    double end = platformTime();
+    glDeleteTextures(1, &texture);
+
+    if (times) {
+        times->dispatchMs = (dispatched - start) * 1000.0;
+        times->readbackMs = (end - dispatched) * 1000.0;
+    }
+    return glGetError() == GL_NO_ERROR;
+}
@@ -0,0 +1,20 @@
+#ifndef GPU_RENDER_H
+#define GPU_RENDER_H
+
+#include "mandel.h"
+#include "shader_variant.h"
+
+// Offscreen GPU backend for the headless renderer: the view is rendered by the
+// compute kernel into an RGBA8 texture and read back, no window involved.
+
+typedef struct {
+    double dispatchMs;  // dispatch until the GPU is done, measured on the CPU
+    double readbackMs;
+} GpuRenderTimes;
+
+// renders view into rgbOut (width*height*3 bytes, bottom row first) with a
+// current context; returns 0 if no variant compiles or the size is too large
+int gpuRenderView(VariantCache* cache, const MandelView* view, int width, int height,
+                  ColourMode colour, unsigned char* rgbOut, GpuRenderTimes* times);
+
+#endif
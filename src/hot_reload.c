@@ -0,0 +1,201 @@
+#include "hot_reload.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.h"
+#include "shader_source.h"
+
+static int checkLinked(GLuint program, const char* what) {
+    GLint ok = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (ok) return 1;
+    char log[1024];
+    glGetProgramInfoLog(program, sizeof(log), NULL, log);
+    fprintf(stderr, "Failed to link %s:\n%s\n", what, log);
+    return 0;
+}
+
+// on the worker's context; stops at the first failure, the caller deletes what was built
+static int runJob(HotReload* r) {
+    if (r->kinds & RELOAD_COMPUTE) {
+        for (int i = 0; i < r->variantCount; i++) {
+            char* source = buildVariantSource(r->computeSource, &r->variants[i]);
+            r->programs[i] = source ? createComputeProgram(source) : 0;
+            free(source);
+            if (!r->programs[i]) return 0;
+        }
+    }
+    if (r->kinds & RELOAD_SCREEN) {
+        r->screenProgram = r->createScreenProgram(r->vertexSource, r->fragmentSource);
+        if (!checkLinked(r->screenProgram, "screen program")) return 0;
+    }
+    return 1;
+}
+
+static void* workerMain(void* arg) {
+    HotReload* r = arg;
+    glfwMakeContextCurrent(r->context);
+    pthread_mutex_lock(&r->lock);
+    for (;;) {
+        while (!r->quit && !(r->busy && !r->done)) pthread_cond_wait(&r->wake, &r->lock);
+        if (r->quit) break;
+        pthread_mutex_unlock(&r->lock);
+
+        double start = platformTime();
+        int ok = runJob(r);
+        // the programs have to be complete before another context uses them
+        glFinish();
+        double compileMs = (platformTime() - start) * 1000.0;
+
+        pthread_mutex_lock(&r->lock);
+        r->ok = ok;
+        r->compileMs = compileMs;
+        r->done = 1;
+        glfwPostEmptyEvent();
+    }
+    pthread_mutex_unlock(&r->lock);
+    glfwMakeContextCurrent(NULL);
+    return NULL;
+}
+
+int initHotReload(HotReload* r, GLFWwindow* window, const char* computeName,
+                  const char* vertexName, const char* fragmentName,
+                  ScreenProgramFn createScreenProgram) {
+    memset(r, 0, sizeof(*r));
+    const char* dir = shaderDirectory();
+    if (!dir) return 0;
+    r->computeName = computeName;
+    r->vertexName = vertexName;
+    r->fragmentName = fragmentName;
+    r->createScreenProgram = createScreenProgram;
+
+    const char* names[3] = {computeName, vertexName, fragmentName};
+    if (!initShaderWatch(&r->watch, dir, names, 3)) {
+        fprintf(stderr, "Failed to watch %s\n", dir);
+        return 0;
+    }
+    // same context hints as the main window, which are still set
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    r->context = glfwCreateWindow(1, 1, "shader reload", NULL, window);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (!r->context) {
+        fprintf(stderr, "Failed to create a shared context for reloading\n");
+        destroyShaderWatch(&r->watch);
+        return 0;
+    }
+
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->wake, NULL);
+    if (pthread_create(&r->worker, NULL, workerMain, r) != 0) {
+        pthread_cond_destroy(&r->wake);
+        pthread_mutex_destroy(&r->lock);
+        glfwDestroyWindow(r->context);
+        destroyShaderWatch(&r->watch);
+        return 0;
+    }
+    return 1;
+}
+
+static void freeJobSources(HotReload* r) {
+    free(r->computeSource);
+    free(r->vertexSource);
+    free(r->fragmentSource);
+    r->computeSource = r->vertexSource = r->fragmentSource = NULL;
+}
+
+static void startJob(HotReload* r, const VariantCache* cache, unsigned changed) {
+    unsigned kinds = 0;
+    if (changed & 1u) kinds |= RELOAD_COMPUTE;
+    if (changed & 6u) kinds |= RELOAD_SCREEN;
+
+    if (kinds & RELOAD_COMPUTE) {
+        r->computeSource = loadShaderSource(r->computeName);
+        if (!r->computeSource) kinds &= ~RELOAD_COMPUTE;
+        r->variantCount = readyVariants(cache, r->variants, VARIANT_CACHE_SIZE);
+    }
+    if (kinds & RELOAD_SCREEN) {
+        r->vertexSource = loadShaderSource(r->vertexName);
+        r->fragmentSource = loadShaderSource(r->fragmentName);
+        if (!r->vertexSource || !r->fragmentSource) kinds &= ~RELOAD_SCREEN;
+    }
+    if (!kinds) {
+        freeJobSources(r);
+        return;
+    }
+
+    pthread_mutex_lock(&r->lock);
+    r->kinds = kinds;
+    memset(r->programs, 0, sizeof(r->programs));
+    r->screenProgram = 0;
+    r->done = 0;
+    r->busy = 1;
+    pthread_cond_signal(&r->wake);
+    pthread_mutex_unlock(&r->lock);
+}
+
+unsigned updateHotReload(HotReload* r, VariantCache* cache, GLuint* screenProgram) {
+    r->queued |= pollShaderWatch(&r->watch);
+
+    pthread_mutex_lock(&r->lock);
+    int done = r->busy && r->done;
+    pthread_mutex_unlock(&r->lock);
+
+    unsigned swapped = 0;
+    if (done) {
+        if (r->ok) {
+            if (r->kinds & RELOAD_COMPUTE) {
+                replaceVariantPrograms(cache, r->computeSource, r->variants, r->programs, r->variantCount);
+                free(r->liveSource);
+                r->liveSource = r->computeSource;
+                r->computeSource = NULL;
+            }
+            if (r->kinds & RELOAD_SCREEN) {
+                glDeleteProgram(*screenProgram);
+                *screenProgram = r->screenProgram;
+            }
+            swapped = r->kinds;
+            printf("reloaded %s%s%s in %.1f ms\n",
+                   r->kinds & RELOAD_COMPUTE ? r->computeName : "",
+                   r->kinds == (RELOAD_COMPUTE | RELOAD_SCREEN) ? " and " : "",
+                   r->kinds & RELOAD_SCREEN ? "the screen program" : "", r->compileMs);
+        } else {
+            for (int i = 0; i < VARIANT_CACHE_SIZE; i++) {
+                if (r->programs[i]) glDeleteProgram(r->programs[i]);
+            }
+            if (r->screenProgram) glDeleteProgram(r->screenProgram);
+            fprintf(stderr, "reload failed, keeping the running shaders\n");
+        }
+        freeJobSources(r);
+        r->busy = 0;
+    }
+
+    if (!r->busy && r->queued) {
+        unsigned changed = r->queued;
+        r->queued = 0;
+        startJob(r, cache, changed);
+    }
+    return swapped;
+}
+
+void destroyHotReload(HotReload* r) {
+    pthread_mutex_lock(&r->lock);
+    r->quit = 1;
+    pthread_cond_signal(&r->wake);
+    pthread_mutex_unlock(&r->lock);
+    pthread_join(r->worker, NULL);
+    pthread_cond_destroy(&r->wake);
+    pthread_mutex_destroy(&r->lock);
+
+    if (r->busy && r->done) {
+        for (int i = 0; i < VARIANT_CACHE_SIZE; i++) {
+            if (r->programs[i]) glDeleteProgram(r->programs[i]);
+        }
+        if (r->screenProgram) glDeleteProgram(r->screenProgram);
+    }
+    freeJobSources(r);
+    free(r->liveSource);
+    glfwDestroyWindow(r->context);
+    destroyShaderWatch(&r->watch);
+}
@@ -0,0 +1,69 @@
+#ifndef HOT_RELOAD_H
+#define HOT_RELOAD_H
+
+#include <pthread.h>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "shader_variant.h"
+#include "shader_watch.h"
+
+// Recompiles edited shaders while the app keeps running. Saves in the shader
+// directory are picked up by a ShaderWatch; the sources are compiled on a
+// worker thread that owns a hidden window whose context shares objects with
+// the main one, so the frame loop never waits on the compiler. The results
+// are swapped in between two frames, all at once and only if everything
+// linked; on any failure the running programs are kept.
+
+typedef GLuint (*ScreenProgramFn)(const char* vertexSource, const char* fragmentSource);
+
+enum {
+    RELOAD_COMPUTE = 1 << 0,
+    RELOAD_SCREEN = 1 << 1
+};
+
+typedef struct {
+    ShaderWatch watch;
+    const char* computeName;
+    const char* vertexName;
+    const char* fragmentName;
+    ScreenProgramFn createScreenProgram;
+    GLFWwindow* context;
+    pthread_t worker;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    int quit;
+
+    // the job, only written by the GL thread while the worker is idle
+    int busy;
+    unsigned kinds;
+    char* computeSource;
+    char* vertexSource;
+    char* fragmentSource;
+    KernelVariant variants[VARIANT_CACHE_SIZE];
+    int variantCount;
+    // changes seen while a job runs, started once it is swapped
+    unsigned queued;
+
+    // written by the worker, read once done is set
+    int done;
+    int ok;
+    GLuint programs[VARIANT_CACHE_SIZE];
+    GLuint screenProgram;
+    double compileMs;
+
+    // compute source the cache points at since the last swap, owned here
+    char* liveSource;
+} HotReload;
+
+// needs the shader directory set (dev mode); creates the shared context on
+// the calling (main) thread; returns 0 if reloading is not possible
+int initHotReload(HotReload* r, GLFWwindow* window, const char* computeName,
+                  const char* vertexName, const char* fragmentName,
+                  ScreenProgramFn createScreenProgram);
+// starts a job for new saves and swaps in a finished one; returns the
+// RELOAD_ bits swapped in, the old screen program is deleted
+unsigned updateHotReload(HotReload* r, VariantCache* cache, GLuint* screenProgram);
+void destroyHotReload(HotReload* r);
+
+#endif
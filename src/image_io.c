@@ -0,0 +1,201 @@
+#include "image_io.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "platform.h"
+
+// stored deflate blocks hold at most this many bytes
+#define DEFLATE_BLOCK_MAX 65535
+
+static const char* IMAGE_FORMAT_NAMES[IMAGE_FORMAT_COUNT] = {"ppm", "pfm", "png"};
+
+int imageFormatFromPath(const char* path) {
+    const char* dot = strrchr(path, '.');
+    if (!dot) return -1;
+    for (int i = 0; i < IMAGE_FORMAT_COUNT; i++) {
+        const char* a = dot + 1;
+        const char* b = IMAGE_FORMAT_NAMES[i];
+        while (*a && (*a | 0x20) == *b) {
+            a++;
+            b++;
+        }
+        if (!*a && !*b) return i;
+    }
+    return -1;
+}
+
+const char* imageFormatName(ImageFormat format) {
+    return format >= 0 && format < IMAGE_FORMAT_COUNT ? IMAGE_FORMAT_NAMES[format] : "unknown";
+}
+
+static void markFirstByte(FILE* fp, double* firstByte) {
+    if (!firstByte) return;
+    fflush(fp);
+    *firstByte = platformTime();
+}
+
+int writePPM(const char* path, int width, int height, const unsigned char* rgb, double* firstByte) {
+    FILE* fp = fopen(path, "wb");
+    if (!fp) return 0;
+    fprintf(fp, "P6\n%d %d\n255\n", width, height);
+    markFirstByte(fp, firstByte);
+    size_t row = (size_t)width * 3;
+    int ok = 1;
+    for (int y = height - 1; y >= 0 && ok; y--) {
+        ok = fwrite(rgb + (size_t)y*row, 1, row, fp) == row;
+    }
+    return fclose(fp) == 0 && ok;
+}
+
+// PFM is bottom row first already; a negative scale means little endian
+int writePFM(const char* path, int width, int height, const float* values, double* firstByte) {
+    FILE* fp = fopen(path, "wb");
+    if (!fp) return 0;
+    const uint16_t probe = 1;
+    int littleEndian = *(const unsigned char*)&probe == 1;
+    fprintf(fp, "Pf\n%d %d\n%s\n", width, height, littleEndian ? "-1.0" : "1.0");
+    markFirstByte(fp, firstByte);
+    size_t count = (size_t)width * height;
+    int ok = fwrite(values, sizeof(float), count, fp) == count;
+    return fclose(fp) == 0 && ok;
+}
+
+static uint32_t crcTable[256];
+
+static void initCrcTable(void) {
+    if (crcTable[1]) return;
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crcTable[n] = c;
+    }
+}
+
+static uint32_t crcUpdate(uint32_t crc, const unsigned char* data, size_t length) {
+    for (size_t i = 0; i < length; i++) crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+// the sums are reduced every ADLER_NMAX bytes, the most that cannot overflow 32 bits
+#define ADLER_MOD 65521
+#define ADLER_NMAX 5552
+
+static void adlerUpdate(uint32_t* a, uint32_t* b, const unsigned char* data, size_t length) {
+    while (length > 0) {
+        size_t n = length < ADLER_NMAX ? length : ADLER_NMAX;
+        for (size_t i = 0; i < n; i++) {
+            *a += data[i];
+            *b += *a;
+        }
+        *a %= ADLER_MOD;
+        *b %= ADLER_MOD;
+        data += n;
+        length -= n;
+    }
+}
+
+// writes the bytes and folds them into the running chunk CRC
+typedef struct {
+    FILE* fp;
+    uint32_t crc;
+    int ok;
+} PngWriter;
+
+static void pngBytes(PngWriter* w, const void* data, size_t length) {
+    w->crc = crcUpdate(w->crc, data, length);
+    if (w->ok && fwrite(data, 1, length, w->fp) != length) w->ok = 0;
+}
+
+static void pngU32(PngWriter* w, uint32_t value) {
+    unsigned char b[4] = {value >> 24, value >> 16, value >> 8, value};
+    pngBytes(w, b, 4);
+}
+
+static void pngChunkBegin(PngWriter* w, uint32_t length, const char* type) {
+    unsigned char b[4] = {length >> 24, length >> 16, length >> 8, length};
+    if (w->ok && fwrite(b, 1, 4, w->fp) != 4) w->ok = 0;
+    w->crc = 0xFFFFFFFFu;
+    pngBytes(w, type, 4);
+}
+
+static void pngChunkEnd(PngWriter* w) {
+    uint32_t crc = w->crc ^ 0xFFFFFFFFu;
+    unsigned char b[4] = {crc >> 24, crc >> 16, crc >> 8, crc};
+    if (w->ok && fwrite(b, 1, 4, w->fp) != 4) w->ok = 0;
+}
+
+// Streams the rows into one IDAT of stored deflate blocks, so nothing but the
+// file is buffered. Each row is a filter byte of 0 followed by the pixels.
+int writePNG(const char* path, int width, int height, const unsigned char* rgb, double* firstByte) {
+    size_t row = (size_t)width * 3;
+    size_t raw = (row + 1) * (size_t)height;
+    size_t blocks = raw ? (raw + DEFLATE_BLOCK_MAX - 1) / DEFLATE_BLOCK_MAX : 1;
+    size_t idatLength = 2 + blocks*5 + raw + 4;
+    if (idatLength > 0x7FFFFFFFu) return 0;
+
+    FILE* fp = fopen(path, "wb");
+    if (!fp) return 0;
+    initCrcTable();
+    PngWriter w = {fp, 0, 1};
+
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    pngBytes(&w, signature, sizeof(signature));
+
+    pngChunkBegin(&w, 13, "IHDR");
+    pngU32(&w, (uint32_t)width);
+    pngU32(&w, (uint32_t)height);
+    // 8 bit RGB, deflate, no filtering beyond per-row type, no interlace
+    static const unsigned char ihdr[5] = {8, 2, 0, 0, 0};
+    pngBytes(&w, ihdr, sizeof(ihdr));
+    pngChunkEnd(&w);
+    markFirstByte(fp, firstByte);
+
+    pngChunkBegin(&w, (uint32_t)idatLength, "IDAT");
+    static const unsigned char zlibHeader[2] = {0x78, 0x01};
+    pngBytes(&w, zlibHeader, 2);
+
+    uint32_t adlerA = 1, adlerB = 0;
+    size_t blockLeft = 0;
+    size_t written = 0;
+    for (int y = height - 1; y >= 0; y--) {
+        const unsigned char* src = rgb + (size_t)y*row;
+        static const unsigned char filter = 0;
+        for (size_t x = 0; x < row + 1; ) {
+            if (blockLeft == 0) {
+                size_t length = raw - written < DEFLATE_BLOCK_MAX ? raw - written : DEFLATE_BLOCK_MAX;
+                unsigned char header[5] = {written + length == raw, length, length >> 8,
+                                           ~length, ~length >> 8};
+                pngBytes(&w, header, 5);
+                blockLeft = length;
+            }
+            const unsigned char* data = x == 0 ? &filter : src + x - 1;
+            size_t n = x == 0 ? 1 : row + 1 - x;
+            if (n > blockLeft) n = blockLeft;
+            pngBytes(&w, data, n);
+            adlerUpdate(&adlerA, &adlerB, data, n);
+            x += n;
+            written += n;
+            blockLeft -= n;
+        }
+    }
+    if (raw == 0) {
+        static const unsigned char emptyBlock[5] = {1, 0, 0, 0xFF, 0xFF};
+        pngBytes(&w, emptyBlock, 5);
+    }
+    pngU32(&w, adlerB << 16 | adlerA);
+    pngChunkEnd(&w);
+
+    pngChunkBegin(&w, 0, "IEND");
+    pngChunkEnd(&w);
+    int ok = w.ok;
+    return fclose(fp) == 0 && ok;
+}
+
+void formatFramePath(char* out, size_t size, const char* pattern, unsigned long long frame) {
+    const char* dot = strrchr(pattern, '.');
+    const char* slash = strrchr(pattern, '/');
+    if (!dot || (slash && dot < slash)) dot = pattern + strlen(pattern);
+    snprintf(out, size, "%.*s%05llu%s", (int)(dot - pattern), pattern, frame, dot);
+}
@@ -0,0 +1,31 @@
+#ifndef IMAGE_IO_H
+#define IMAGE_IO_H
+
+#include <stddef.h>
+
+// Image files for the headless renderer. Pixels are stored bottom row first,
+// like the GL image and mandelRenderRegion; the writers flip where the file
+// format wants the top row first.
+
+typedef enum {
+    IMAGE_PPM = 0,  // binary RGB8
+    IMAGE_PFM,      // one float per pixel, the escape iteration (MANDEL_INSIDE inside)
+    IMAGE_PNG,      // RGB8, uncompressed deflate so it needs no zlib
+    IMAGE_FORMAT_COUNT
+} ImageFormat;
+
+// picks the format from the extension of path, returns -1 if it is none of them
+int imageFormatFromPath(const char* path);
+const char* imageFormatName(ImageFormat format);
+
+// rgb is width*height*3 bytes for PPM and PNG, values is width*height floats for PFM.
+// firstByte, if not NULL, gets the platformTime() at which the header reached the file.
+// Return 0 on failure.
+int writePPM(const char* path, int width, int height, const unsigned char* rgb, double* firstByte);
+int writePFM(const char* path, int width, int height, const float* values, double* firstByte);
+int writePNG(const char* path, int width, int height, const unsigned char* rgb, double* firstByte);
+
+// pattern with the frame number before the extension, "frames/f.ppm" -> "frames/f00042.ppm"
+void formatFramePath(char* out, size_t size, const char* pattern, unsigned long long frame);
+
+#endif
@@ -0,0 +1,112 @@
+#include "mandel.h"
+
+#include <math.h>
+#include <stddef.h>
+
+#include "trace.h"
+
+const int MANDEL_UNROLLS[MANDEL_UNROLL_COUNT] = {1, 2, 4, 8, 16};
+
+const MandelView MANDEL_STANDARD_VIEWS[MANDEL_STANDARD_VIEW_COUNT] = {
+    {"home",      -0.75,          0.0,           3.5,   256},
+    {"seahorse",  -0.743643887,   0.131825904,   0.01,  1000},
+    {"elephant",   0.2925,        0.0149,        0.01,  1000},
+    {"cardioid",  -0.2,           0.0,           0.5,   1000},
+    {"minibrot",  -1.768778833,  -0.001738996,   2e-6,  4000},
+};
+
+// K iterations are run back to back and only the last |z|^2 is tested.
+// On escape the state saved before the block is restored and the block is
+// replayed one iteration at a time, so the returned count is exact.
+// The test is written as !(r2 <= 4) so that a block which overflows to
+// inf/nan still counts as escaped.
+static inline int iterateUnrolled(double cx, double cy, int maxIter, const int K) {
+    double zx = 0.0, zy = 0.0;
+    int i = 0;
+    while (i + K <= maxIter + 1) {
+        double sx = zx, sy = zy;
+        for (int k = 0; k < K; k++) {
+            double t = zx*zx - zy*zy + cx;
+            zy = 2.0*zx*zy + cy;
+            zx = t;
+        }
+        if (!(zx*zx + zy*zy <= 4.0)) {
+            zx = sx;
+            zy = sy;
+            break;
+        }
+        i += K;
+    }
+    for (; i <= maxIter; i++) {
+        double t = zx*zx - zy*zy + cx;
+        zy = 2.0*zx*zy + cy;
+        zx = t;
+        if (zx*zx + zy*zy > 4.0) return i;
+    }
+    return MANDEL_INSIDE;
+}
+
+static int iterateK1(double cx, double cy, int maxIter) { return iterateUnrolled(cx, cy, maxIter, 1); }
+static int iterateK2(double cx, double cy, int maxIter) { return iterateUnrolled(cx, cy, maxIter, 2); }
+static int iterateK4(double cx, double cy, int maxIter) { return iterateUnrolled(cx, cy, maxIter, 4); }
+static int iterateK8(double cx, double cy, int maxIter) { return iterateUnrolled(cx, cy, maxIter, 8); }
+static int iterateK16(double cx, double cy, int maxIter) { return iterateUnrolled(cx, cy, maxIter, 16); }
+
+// the home view maps u in [0,1] to [-2.5,1] and v in [0,1] to [-1.5,1.5]
+void mandelViewSection(const MandelView* view, int width, int height, double section[4]) {
+    double spanY = view->span * (double)height / (double)width;
+    section[0] = (view->cx - 0.5*view->span + 2.5) / 3.5;
+    section[1] = (view->cy - 0.5*spanY + 1.5) / 3.0;
+    section[2] = (view->cx + 0.5*view->span + 2.5) / 3.5;
+    section[3] = (view->cy + 0.5*spanY + 1.5) / 3.0;
+}
+
+MandelIterateFn mandelGetIterate(int unroll) {
+    switch (unroll) {
+        case 1: return iterateK1;
+        case 2: return iterateK2;
+        case 4: return iterateK4;
+        case 8: return iterateK8;
+        case 16: return iterateK16;
+        default: return NULL;
+    }
+}
+
+void mandelRenderRegion(const MandelView* view, int width, int height,
+                        int x0, int y0, int x1, int y1,
+                        MandelIterateFn iterate, int* iterOut) {
+    double traceStart = traceBegin();
+    double spanY = view->span * (double)height / (double)width;
+    double left = view->cx - 0.5*view->span;
+    double bottom = view->cy - 0.5*spanY;
+
+    for (int y = y0; y < y1; y++) {
+        double cy = bottom + spanY * ((double)y / (double)height);
+        for (int x = x0; x < x1; x++) {
+            double cx = left + view->span * ((double)x / (double)width);
+            iterOut[(size_t)y*width + x] = iterate(cx, cy, view->depth);
+        }
+    }
+    traceEnd("tile", traceStart);
+}
+
+static unsigned char toUnorm8(double v) {
+    if (!(v > 0.0)) return 0;
+    if (v >= 1.0) return 255;
+    return (unsigned char)(v*255.0 + 0.5);
+}
+
+void mandelColour(int iter, int depth, int colourMode, unsigned char rgb[3]) {
+    if (iter == MANDEL_INSIDE) {
+        rgb[0] = rgb[1] = rgb[2] = 0;
+        return;
+    }
+    double s = (double)iter / (double)depth;
+    if (colourMode == 2) {
+        rgb[0] = rgb[1] = rgb[2] = toUnorm8(s);
+        return;
+    }
+    rgb[0] = toUnorm8((cos(pow(1.4, s*8.0)) + 1.0)*0.3);
+    rgb[1] = toUnorm8(s);
+    rgb[2] = toUnorm8(1.5 - s);
+}
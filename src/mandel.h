@@ -0,0 +1,43 @@
+#ifndef MANDEL_H
+#define MANDEL_H
+
+// CPU reference of the kernel in shader/compute_shader.glsl.
+// Iteration counts match the shader: the loop runs i = 0..maxIter and
+// returns the i at which |z| first exceeds 2, or MANDEL_INSIDE.
+
+#define MANDEL_INSIDE (-1)
+
+// unroll factors that have a compiled variant (K iterations between escape checks)
+#define MANDEL_UNROLL_COUNT 5
+extern const int MANDEL_UNROLLS[MANDEL_UNROLL_COUNT];
+
+typedef struct {
+    const char* name;
+    double cx;
+    double cy;
+    double span;    // width of the view on the real axis
+    int depth;
+} MandelView;
+
+#define MANDEL_STANDARD_VIEW_COUNT 5
+extern const MandelView MANDEL_STANDARD_VIEWS[MANDEL_STANDARD_VIEW_COUNT];
+
+// A and B of the view in UVs of the home view, the section the compute kernel takes
+void mandelViewSection(const MandelView* view, int width, int height, double section[4]);
+
+typedef int (*MandelIterateFn)(double cx, double cy, int maxIter);
+
+// returns NULL if there is no compiled variant for this unroll factor
+MandelIterateFn mandelGetIterate(int unroll);
+
+// fills iterOut (width*height, row 0 at the bottom like the GL image) for the
+// pixel rectangle [x0,x1) x [y0,y1) of a width x height render of view
+void mandelRenderRegion(const MandelView* view, int width, int height,
+                        int x0, int y0, int x1, int y1,
+                        MandelIterateFn iterate, int* iterOut);
+
+// the shader's colouring of an iteration count, COLOUR_MODE numbering; smooth
+// needs the final z which the CPU kernel does not return, so it is the palette here
+void mandelColour(int iter, int depth, int colourMode, unsigned char rgb[3]);
+
+#endif
@@ -0,0 +1,41 @@
+#include "parallel_compile.h"
+
+#include <string.h>
+
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+static int available = 0;
+
+static int hasExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (extension && strcmp(extension, name) == 0) return 1;
+    }
+    return 0;
+}
+
+int initParallelCompile(GLADloadproc load) {
+    PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxThreads = NULL;
+    if (hasExtension("GL_KHR_parallel_shader_compile")) {
+        maxThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsKHR");
+    } else if (hasExtension("GL_ARB_parallel_shader_compile")) {
+        maxThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsARB");
+    }
+    available = maxThreads != NULL;
+    // 0xFFFFFFFF leaves the thread count to the implementation
+    if (available) maxThreads(0xFFFFFFFFu);
+    return available;
+}
+
+int parallelCompileAvailable(void) {
+    return available;
+}
+
+int programLinkComplete(GLuint program) {
+    if (!available) return 1;
+    GLint complete = GL_TRUE;
+    glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete == GL_TRUE;
+}
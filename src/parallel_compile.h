@@ -0,0 +1,23 @@
+#ifndef PARALLEL_COMPILE_H
+#define PARALLEL_COMPILE_H
+
+#include <glad/glad.h>
+
+// GL_KHR_parallel_shader_compile / GL_ARB_parallel_shader_compile. The glad
+// loader is generated without extensions, so the entry point and enum are
+// loaded here. With the extension compiles and links run on driver threads
+// and GL_COMPLETION_STATUS_KHR can be polled without blocking; without it
+// every program reports complete and the first status query compiles it.
+
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+
+// asks the driver for as many compiler threads as it likes, returns 0 if
+// neither extension is there
+int initParallelCompile(GLADloadproc load);
+int parallelCompileAvailable(void);
+
+// non-blocking when the extension is available
+int programLinkComplete(GLuint program);
+
+#endif
@@ -0,0 +1,167 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "platform.h"
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+// mingw-w64 gets clock_gettime and nanosleep from winpthreads
+#include <direct.h>
+#include <pthread.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+double platformTime(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+double platformCpuTime(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void platformSleepUntil(double deadline) {
+    double remaining = deadline - platformTime();
+    if (remaining > PLATFORM_SPIN_MARGIN) {
+        double coarse = remaining - PLATFORM_SPIN_MARGIN;
+        struct timespec ts;
+        ts.tv_sec = (time_t)coarse;
+        ts.tv_nsec = (long)((coarse - (double)ts.tv_sec) * 1e9);
+        nanosleep(&ts, NULL);
+    }
+    while (platformTime() < deadline) {}
+}
+
+void platformSleep(double seconds) {
+    platformSleepUntil(platformTime() + seconds);
+}
+
+int platformCpuCount(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int count = (int)info.dwNumberOfProcessors;
+#else
+    int count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return count > 0 ? count : 1;
+}
+
+int platformMakeDir(const char* path) {
+#ifdef _WIN32
+    int result = _mkdir(path);
+#else
+    int result = mkdir(path, 0755);
+#endif
+    return result == 0 || errno == EEXIST;
+}
+
+#ifdef _WIN32
+
+int platformMapFile(MappedFile* file, const char* path, size_t newSize) {
+    file->data = NULL;
+    file->mapping = NULL;
+    file->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                             NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file->file == INVALID_HANDLE_VALUE) return 0;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file->file, &size)) {
+        CloseHandle(file->file);
+        return 0;
+    }
+    file->size = size.QuadPart > 0 ? (size_t)size.QuadPart : newSize;
+    // a mapping larger than the file grows it
+    unsigned long long length = file->size;
+    file->mapping = CreateFileMappingA(file->file, NULL, PAGE_READWRITE,
+                                       (DWORD)(length >> 32), (DWORD)length, NULL);
+    if (file->mapping) file->data = MapViewOfFile(file->mapping, FILE_MAP_ALL_ACCESS, 0, 0, file->size);
+    if (!file->data) {
+        if (file->mapping) CloseHandle(file->mapping);
+        CloseHandle(file->file);
+        return 0;
+    }
+    return 1;
+}
+
+void platformUnmapFile(MappedFile* file) {
+    UnmapViewOfFile(file->data);
+    CloseHandle(file->mapping);
+    CloseHandle(file->file);
+    file->data = NULL;
+}
+
+int platformLockFile(MappedFile* file) {
+    OVERLAPPED at = {0};
+    return LockFileEx(file->file, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &at) != 0;
+}
+
+void platformUnlockFile(MappedFile* file) {
+    OVERLAPPED at = {0};
+    UnlockFileEx(file->file, 0, MAXDWORD, MAXDWORD, &at);
+}
+
+#else
+
+int platformMapFile(MappedFile* file, const char* path, size_t newSize) {
+    file->data = NULL;
+    file->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (file->fd < 0) return 0;
+    struct stat st;
+    if (fstat(file->fd, &st) != 0) {
+        close(file->fd);
+        return 0;
+    }
+    // posix_fallocate only ever grows the file, so two processes creating it
+    // at once cannot shrink it under each other; the blocks are reserved
+    // too, so a full disk fails here rather than on a write to the mapping
+    if (st.st_size == 0 && (posix_fallocate(file->fd, 0, (off_t)newSize) != 0 || fstat(file->fd, &st) != 0)) {
+        close(file->fd);
+        return 0;
+    }
+    file->size = (size_t)st.st_size;
+    void* data = mmap(NULL, file->size, PROT_READ | PROT_WRITE, MAP_SHARED, file->fd, 0);
+    if (data == MAP_FAILED) {
+        close(file->fd);
+        return 0;
+    }
+    file->data = data;
+    return 1;
+}
+
+void platformUnmapFile(MappedFile* file) {
+    munmap(file->data, file->size);
+    close(file->fd);
+    file->data = NULL;
+}
+
+static int lockWholeFile(int fd, short type) {
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = type;
+    lock.l_whence = SEEK_SET;
+    // a length of 0 reaches to the end, however far the file grows
+    int result;
+    do {
+        result = fcntl(fd, F_SETLKW, &lock);
+    } while (result != 0 && errno == EINTR);
+    return result == 0;
+}
+
+int platformLockFile(MappedFile* file) {
+    return lockWholeFile(file->fd, F_WRLCK);
+}
+
+void platformUnlockFile(MappedFile* file) {
+    lockWholeFile(file->fd, F_UNLCK);
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stddef.h>
+
+// monotonic time in seconds, usable from any thread
+double platformTime(void);
+// CPU time used by the whole process in seconds
+double platformCpuTime(void);
+
+// sleeps until platformTime() reaches deadline; the scheduler sleeps up to
+// PLATFORM_SPIN_MARGIN early and the rest is spun, so the wakeup is precise
+#define PLATFORM_SPIN_MARGIN 0.002
+void platformSleepUntil(double deadline);
+void platformSleep(double seconds);
+
+// logical processors available, at least 1
+int platformCpuCount(void);
+
+// creates the directory, returns 1 if it exists afterwards
+int platformMakeDir(const char* path);
+
+// a file mapped read-write, shared with every process that maps it
+typedef struct {
+    void* data;
+    size_t size;
+#ifdef _WIN32
+    void* file;
+    void* mapping;
+#else
+    int fd;
+#endif
+} MappedFile;
+
+// opens or creates path and maps all of it; a new or empty file is first
+// grown to newSize, an existing one keeps its size; returns 0 on failure
+int platformMapFile(MappedFile* file, const char* path, size_t newSize);
+void platformUnmapFile(MappedFile* file);
+// an exclusive lock on the whole file, waited for; the system drops it when
+// the process holding it dies, so it tells whether that process is still there
+int platformLockFile(MappedFile* file);
+void platformUnlockFile(MappedFile* file);
+
+#endif
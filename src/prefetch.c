@@ -0,0 +1,156 @@
+#include "prefetch.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+void zoomSection(const double section[4], double u, double v, double factor, double out[4]) {
+    double width = section[2] - section[0];
+    double height = section[3] - section[1];
+    double x = section[0] + u*width;
+    double y = section[1] + v*height;
+    double halfWidth = 0.5*width/factor;
+    double halfHeight = 0.5*height/factor;
+    out[0] = x - halfWidth;
+    out[1] = y - halfHeight;
+    out[2] = x + halfWidth;
+    out[3] = y + halfHeight;
+}
+
+void initPrefetcher(Prefetcher* p) {
+    memset(p, 0, sizeof(*p));
+    p->cursorU = -1.0;
+    p->cursorV = -1.0;
+}
+
+static int insideWindow(double u, double v) {
+    return u >= 0.0 && u <= 1.0 && v >= 0.0 && v <= 1.0;
+}
+
+static void predict(Prefetcher* p, PrefetchKind kind) {
+    PrefetchView* view = &p->views[kind];
+    view->rendered = 0;
+    if (kind == PREFETCH_ZOOM_OUT) {
+        zoomSection(p->section, 0.5, 0.5, 0.5, view->section);
+    } else {
+        zoomSection(p->section, p->cursorU, p->cursorV, kind == PREFETCH_ZOOM_IN ? 2.0 : 4.0, view->section);
+    }
+}
+
+PrefetchView* nextPrefetch(Prefetcher* p, TargetPool* pool, const double section[4],
+                           const void* key, size_t keySize, int width, int height, GLenum format,
+                           double cursorU, double cursorV, double now) {
+    p->pending = 0;
+    if (keySize > PREFETCH_KEY_MAX) return NULL;
+    int moved = fabs(cursorU - p->cursorU) > PREFETCH_CURSOR_SLACK ||
+                fabs(cursorV - p->cursorV) > PREFETCH_CURSOR_SLACK;
+    if (moved) {
+        p->cursorU = cursorU;
+        p->cursorV = cursorV;
+        p->restSince = now;
+    }
+    if (p->keySize != keySize || memcmp(p->key, key, keySize) != 0 ||
+        memcmp(p->section, section, sizeof(p->section)) != 0) {
+        memcpy(p->key, key, keySize);
+        p->keySize = keySize;
+        memcpy(p->section, section, sizeof(p->section));
+        for (int i = 0; i < PREFETCH_VIEWS; i++) predict(p, (PrefetchKind)i);
+    } else if (moved) {
+        predict(p, PREFETCH_ZOOM_IN);
+        predict(p, PREFETCH_ZOOM_IN_DEEP);
+    }
+
+    // most likely first, the views around the cursor once it has come to rest
+    int aroundCursor = insideWindow(p->cursorU, p->cursorV);
+    int rested = aroundCursor && now - p->restSince >= PREFETCH_REST_SECONDS;
+    const PrefetchKind order[PREFETCH_VIEWS] = {PREFETCH_ZOOM_IN, PREFETCH_ZOOM_OUT, PREFETCH_ZOOM_IN_DEEP};
+    PrefetchView* next = NULL;
+    for (int i = 0; i < PREFETCH_VIEWS; i++) {
+        PrefetchView* view = &p->views[order[i]];
+        if (view->rendered || (order[i] != PREFETCH_ZOOM_OUT && !aroundCursor)) continue;
+        p->pending++;
+        if (!next && (order[i] == PREFETCH_ZOOM_OUT || rested)) next = view;
+    }
+    if (!next) return NULL;
+
+    if (p->fence) {
+        if (glClientWaitSync(p->fence, 0, 0) == GL_TIMEOUT_EXPIRED) return NULL;
+        glDeleteSync(p->fence);
+        p->fence = 0;
+    }
+    fitTarget(pool, &next->target, width, height, format);
+    return next;
+}
+
+void prefetchDispatched(Prefetcher* p, PrefetchView* view) {
+    view->rendered = 1;
+    p->prefetched++;
+    p->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // the GPU starts on it while the loop waits for events
+    glFlush();
+}
+
+void snapToPrediction(const Prefetcher* p, double* u, double* v) {
+    if (fabs(*u - p->cursorU) <= PREFETCH_CURSOR_SLACK && fabs(*v - p->cursorV) <= PREFETCH_CURSOR_SLACK) {
+        *u = p->cursorU;
+        *v = p->cursorV;
+    }
+}
+
+static int covers(const double outer[4], const double inner[4]) {
+    // a little slack for sections that differ only by rounding
+    double slackX = 1e-9*fabs(outer[2] - outer[0]);
+    double slackY = 1e-9*fabs(outer[3] - outer[1]);
+    return fmin(outer[0], outer[2]) <= fmin(inner[0], inner[2]) + slackX &&
+           fmax(outer[0], outer[2]) >= fmax(inner[0], inner[2]) - slackX &&
+           fmin(outer[1], outer[3]) <= fmin(inner[1], inner[3]) + slackY &&
+           fmax(outer[1], outer[3]) >= fmax(inner[1], inner[3]) - slackY;
+}
+
+PrefetchView* findPrefetched(Prefetcher* p, const double section[4],
+                             const void* key, size_t keySize, int* exact) {
+    p->zooms++;
+    *exact = 0;
+    if (p->keySize != keySize || memcmp(p->key, key, keySize) != 0) return NULL;
+    PrefetchView* best = NULL;
+    double bestArea = 0.0;
+    for (int i = 0; i < PREFETCH_VIEWS; i++) {
+        PrefetchView* view = &p->views[i];
+        if (!view->rendered || !covers(view->section, section)) continue;
+        if (memcmp(view->section, section, sizeof(view->section)) == 0) {
+            best = view;
+            *exact = 1;
+            break;
+        }
+        // the smallest covering view has the most pixels for the new one
+        double area = fabs((view->section[2] - view->section[0])*(view->section[3] - view->section[1]));
+        if (!best || area < bestArea) {
+            best = view;
+            bestArea = area;
+        }
+    }
+    if (best) p->covered++;
+    if (*exact) p->exact++;
+    return best;
+}
+
+void forgetPrefetched(Prefetcher* p) {
+    p->keySize = 0;
+    for (int i = 0; i < PREFETCH_VIEWS; i++) p->views[i].rendered = 0;
+}
+
+void destroyPrefetcher(Prefetcher* p, TargetPool* pool) {
+    if (p->fence) {
+        glClientWaitSync(p->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        glDeleteSync(p->fence);
+    }
+    for (int i = 0; i < PREFETCH_VIEWS; i++) releaseTarget(pool, &p->views[i].target);
+    memset(p, 0, sizeof(*p));
+}
+
+void printPrefetcher(const Prefetcher* p) {
+    printf("prefetch: %llu views rendered ahead, %llu zooms, %llu shown from a prefetched view "
+           "(%.1f%% hit rate), %llu of them exact\n",
+           p->prefetched, p->zooms, p->covered,
+           p->zooms ? 100.0*p->covered/p->zooms : 0.0, p->exact);
+}
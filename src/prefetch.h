@@ -0,0 +1,85 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <stddef.h>
+#include <glad/glad.h>
+
+#include "render_target.h"
+
+// Views the user is likely to go to next, rendered ahead while the current
+// one sits converged: twice and four times closer around the resting cursor
+// (a click zooms twice around it) and twice further out (a right click). One
+// view is dispatched at a time and the next only once the GPU has finished
+// it, so a real frame never queues behind more than one of them. When the
+// user zooms, the smallest prefetched view that covers the new one is shown
+// cropped straight away; if it is the new view exactly it is the render.
+// Views are keyed like the history: section plus whatever else the pixels
+// depend on.
+
+#define PREFETCH_VIEWS 3
+#define PREFETCH_KEY_MAX 128
+// the cursor has to rest this long before the views around it are rendered
+#define PREFETCH_REST_SECONDS 0.15
+// and move further than this (window UVs) to render them again; a click
+// within it zooms around the point the views were rendered for
+#define PREFETCH_CURSOR_SLACK 0.003
+
+typedef enum {
+    PREFETCH_ZOOM_IN,
+    PREFETCH_ZOOM_OUT,
+    PREFETCH_ZOOM_IN_DEEP,
+} PrefetchKind;
+
+typedef struct {
+    // A and B, UVs of the home view
+    double section[4];
+    RenderTarget target;
+    int rendered;
+} PrefetchView;
+
+typedef struct {
+    PrefetchView views[PREFETCH_VIEWS];
+    // the converged view predicted from
+    double section[4];
+    unsigned char key[PREFETCH_KEY_MAX];
+    size_t keySize;
+    // window UVs the zoom-in views are around, and since when it rests there
+    double cursorU;
+    double cursorV;
+    double restSince;
+    // the last dispatch, nothing else goes until it signals
+    GLsync fence;
+    // views left to render for the current prediction
+    int pending;
+    unsigned long long prefetched;
+    unsigned long long zooms;
+    unsigned long long covered;
+    unsigned long long exact;
+} Prefetcher;
+
+// section zoomed by factor around the window point (u, v), below 1 zooms out
+void zoomSection(const double section[4], double u, double v, double factor, double out[4]);
+
+void initPrefetcher(Prefetcher* p);
+// predicts from the converged view and returns the next view to render into
+// its target at width x height, or NULL while the GPU is busy with the last
+// one, the cursor moves or everything is rendered; the caller dispatches it
+// and calls prefetchDispatched, which marks it rendered and fences it. A
+// cursor outside 0..1 only predicts the zoom out.
+PrefetchView* nextPrefetch(Prefetcher* p, TargetPool* pool, const double section[4],
+                           const void* key, size_t keySize, int width, int height, GLenum format,
+                           double cursorU, double cursorV, double now);
+void prefetchDispatched(Prefetcher* p, PrefetchView* view);
+// moves a click within PREFETCH_CURSOR_SLACK of the predicted point onto it
+void snapToPrediction(const Prefetcher* p, double* u, double* v);
+// counts a zoom to section and returns the smallest rendered view that covers
+// it under key, NULL if none; exact is set when it is the view itself
+PrefetchView* findPrefetched(Prefetcher* p, const double section[4],
+                             const void* key, size_t keySize, int* exact);
+// forgets every rendered view, for when the kernel that rendered them
+// changes, which the key does not cover
+void forgetPrefetched(Prefetcher* p);
+void destroyPrefetcher(Prefetcher* p, TargetPool* pool);
+void printPrefetcher(const Prefetcher* p);
+
+#endif
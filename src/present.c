@@ -0,0 +1,91 @@
+#include "present.h"
+
+#include <math.h>
+
+void initPresenter(Presenter* p, PresentMode mode, GLuint program, GLuint quadVao) {
+    p->mode = mode;
+    p->quadVao = quadVao;
+    glCreateFramebuffers(1, &p->fbo);
+    setPresenterProgram(p, program);
+}
+
+void setPresenterProgram(Presenter* p, GLuint program) {
+    p->program = program;
+    // locations are looked up once, the sampler never changes unit
+    glProgramUniform1i(program, glGetUniformLocation(program, "screen"), 0);
+    p->uvScaleLocation = glGetUniformLocation(program, "uvScale");
+    p->uvOffsetLocation = glGetUniformLocation(program, "uvOffset");
+    p->uvMaxLocation = glGetUniformLocation(program, "uvMax");
+}
+
+// draws region (u0, v0, u1, v1 of the rendered part) into the pixels x0..x1, y0..y1
+static void drawRegion(Presenter* p, const RenderTarget* target, const double region[4],
+                       GLuint drawFbo, int x0, int y0, int x1, int y1) {
+    if (p->mode == PRESENT_BLIT) {
+        // attached every time: the pool may have deleted the last texture
+        // and GL handed its name to a new one
+        glNamedFramebufferTexture(p->fbo, GL_COLOR_ATTACHMENT0, target->texture, 0);
+        int srcX0 = (int)floor(region[0]*target->width + 0.5);
+        int srcY0 = (int)floor(region[1]*target->height + 0.5);
+        int srcX1 = (int)floor(region[2]*target->width + 0.5);
+        int srcY1 = (int)floor(region[3]*target->height + 0.5);
+        GLenum filter = (srcX1 - srcX0 == x1 - x0 && srcY1 - srcY0 == y1 - y0) ? GL_NEAREST : GL_LINEAR;
+        glBlitNamedFramebuffer(p->fbo, drawFbo, srcX0, srcY0, srcX1, srcY1,
+                               x0, y0, x1, y1, GL_COLOR_BUFFER_BIT, filter);
+        return;
+    }
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFbo);
+    glViewport(x0, y0, x1 - x0, y1 - y0);
+    glUseProgram(p->program);
+    glBindTextureUnit(0, target->texture);
+    float scaleU = (float)target->width/target->capacityWidth;
+    float scaleV = (float)target->height/target->capacityHeight;
+    glUniform2f(p->uvScaleLocation, (float)(region[2] - region[0])*scaleU, (float)(region[3] - region[1])*scaleV);
+    glUniform2f(p->uvOffsetLocation, (float)region[0]*scaleU, (float)region[1]*scaleV);
+    glUniform2f(p->uvMaxLocation, (target->width - 0.5f)/target->capacityWidth,
+                (target->height - 0.5f)/target->capacityHeight);
+    glBindVertexArray(p->quadVao);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+}
+
+void presentTarget(Presenter* p, const RenderTarget* target, GLuint drawFbo, int width, int height) {
+    const double whole[4] = {0.0, 0.0, 1.0, 1.0};
+    drawRegion(p, target, whole, drawFbo, 0, 0, width, height);
+}
+
+// the part of one axis of the window, 0..pixels, that from covers in to,
+// and where those pixels are in from; 0 if none
+static int reprojectAxis(double from0, double from1, double to0, double to1, int pixels,
+                         int* dst0, int* dst1, double* src0, double* src1) {
+    double a = (from0 - to0)/(to1 - to0);
+    double b = (from1 - to0)/(to1 - to0);
+    *dst0 = (int)ceil(fmax(fmin(a, b), 0.0)*pixels - 0.5);
+    *dst1 = (int)floor(fmin(fmax(a, b), 1.0)*pixels + 0.5);
+    if (*dst1 <= *dst0) return 0;
+    *src0 = (to0 + (to1 - to0)*(*dst0)/pixels - from0)/(from1 - from0);
+    *src1 = (to0 + (to1 - to0)*(*dst1)/pixels - from0)/(from1 - from0);
+    return 1;
+}
+
+void presentReprojected(Presenter* p, const RenderTarget* target, const double from[4],
+                        const double to[4], GLuint drawFbo, int width, int height) {
+    int x0, y0, x1, y1;
+    double region[4];
+    int visible = reprojectAxis(from[0], from[2], to[0], to[2], width, &x0, &x1, &region[0], &region[2]) &&
+                  reprojectAxis(from[1], from[3], to[1], to[3], height, &y0, &y1, &region[1], &region[3]);
+    if (!visible || x0 > 0 || y0 > 0 || x1 < width || y1 < height) {
+        const float black[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+        glClearNamedFramebufferfv(drawFbo, GL_COLOR, 0, black);
+    }
+    if (visible) drawRegion(p, target, region, drawFbo, x0, y0, x1, y1);
+}
+
+GLbitfield presentBarrierBits(const Presenter* p) {
+    return p->mode == PRESENT_BLIT ? GL_FRAMEBUFFER_BARRIER_BIT : GL_TEXTURE_FETCH_BARRIER_BIT;
+}
+
+void destroyPresenter(Presenter* p) {
+    glDeleteFramebuffers(1, &p->fbo);
+    p->fbo = 0;
+}
@@ -0,0 +1,40 @@
+#ifndef PRESENT_H
+#define PRESENT_H
+
+#include "render_target.h"
+
+// Copies the rendered part of a target to the bound draw framebuffer.
+// PRESENT_BLIT attaches the target to a read framebuffer and blits it;
+// PRESENT_QUAD is the fullscreen-quad draw with the screen shader.
+
+typedef enum {
+    PRESENT_BLIT = 0,
+    PRESENT_QUAD = 1
+} PresentMode;
+
+typedef struct {
+    PresentMode mode;
+    GLuint fbo;
+    GLuint program;
+    GLint uvScaleLocation;
+    GLint uvOffsetLocation;
+    GLint uvMaxLocation;
+    GLuint quadVao;
+} Presenter;
+
+void initPresenter(Presenter* p, PresentMode mode, GLuint program, GLuint quadVao);
+// switches the screen program of PRESENT_QUAD, e.g. after a reload
+void setPresenterProgram(Presenter* p, GLuint program);
+// draws into framebuffer drawFbo (0 for the window), scaled to width x height
+void presentTarget(Presenter* p, const RenderTarget* target, GLuint drawFbo, int width, int height);
+// presents a target rendered for section from (A and B, in any units) as it
+// maps into a view of section to: a crop when zooming in, a smaller image
+// on black when zooming out; the blit rounds to whole pixels
+void presentReprojected(Presenter* p, const RenderTarget* target, const double from[4],
+                        const double to[4], GLuint drawFbo, int width, int height);
+void destroyPresenter(Presenter* p);
+
+// glMemoryBarrier bits that make image stores visible to the present
+GLbitfield presentBarrierBits(const Presenter* p);
+
+#endif
@@ -0,0 +1,124 @@
+#include "profiler.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "platform.h"
+#include "trace.h"
+
+static const char* STAGE_NAMES[STAGE_COUNT] = {
+    "input", "upload", "barrier", "dispatch", "present", "swap"
+};
+
+const char* profileStageName(ProfileStage stage) {
+    return STAGE_NAMES[stage];
+}
+
+void initProfiler(Profiler* p) {
+    memset(p, 0, sizeof(*p));
+    for (int f = 0; f < PROFILER_FRAMES_IN_FLIGHT; f++) {
+        glGenQueries(STAGE_COUNT + 1, p->frames[f].queries);
+    }
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    p->gpuClockOffset = platformTime() - (double)gpuNow / 1e9;
+}
+
+void destroyProfiler(Profiler* p) {
+    for (int f = 0; f < PROFILER_FRAMES_IN_FLIGHT; f++) {
+        glDeleteQueries(STAGE_COUNT + 1, p->frames[f].queries);
+    }
+}
+
+static void collectFrame(Profiler* p, GpuFrameQueries* frame) {
+    GLuint available = 0;
+    glGetQueryObjectuiv(frame->queries[frame->marks - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) return;
+
+    GLuint64 stamps[STAGE_COUNT + 1];
+    for (int m = 0; m < frame->marks; m++) {
+        glGetQueryObjectui64v(frame->queries[m], GL_QUERY_RESULT, &stamps[m]);
+    }
+    for (int m = 0; m + 1 < frame->marks; m++) {
+        statsPush(&p->gpu[frame->stages[m]], (double)(stamps[m+1] - stamps[m]) / 1e6);
+        traceComplete(STAGE_NAMES[frame->stages[m]], TRACE_GPU_TID,
+                      (double)stamps[m] / 1e9 + p->gpuClockOffset,
+                      (double)stamps[m+1] / 1e9 + p->gpuClockOffset);
+    }
+    statsPush(&p->gpuFrame, (double)(stamps[frame->marks - 1] - stamps[0]) / 1e6);
+    frame->pending = 0;
+}
+
+void profilerBeginFrame(Profiler* p) {
+    GpuFrameQueries* frame = &p->frames[p->current];
+    if (frame->pending) collectFrame(p, frame);
+    // still not back after a full ring of frames, leave this frame untimed on the GPU
+    p->gpuOpen = !frame->pending;
+    if (p->gpuOpen) frame->marks = 0;
+
+    p->frameStart = platformTime();
+    p->cpuOpen = 0;
+}
+
+void profilerStage(Profiler* p, ProfileStage stage, int gpu) {
+    double now = platformTime();
+    if (p->cpuOpen) {
+        statsPush(&p->cpu[p->cpuStage], (now - p->stageStart) * 1e3);
+        traceEnd(STAGE_NAMES[p->cpuStage], p->stageStart);
+    }
+    p->cpuStage = stage;
+    p->stageStart = now;
+    p->cpuOpen = 1;
+
+    GpuFrameQueries* frame = &p->frames[p->current];
+    if (p->gpuOpen && gpu && frame->marks < STAGE_COUNT) {
+        frame->stages[frame->marks] = stage;
+        glQueryCounter(frame->queries[frame->marks], GL_TIMESTAMP);
+        frame->marks++;
+    }
+}
+
+void profilerEndFrame(Profiler* p) {
+    double now = platformTime();
+    if (p->cpuOpen) {
+        statsPush(&p->cpu[p->cpuStage], (now - p->stageStart) * 1e3);
+        traceEnd(STAGE_NAMES[p->cpuStage], p->stageStart);
+    }
+    statsPush(&p->cpuFrame, (now - p->frameStart) * 1e3);
+    traceEnd("frame", p->frameStart);
+    p->cpuOpen = 0;
+
+    GpuFrameQueries* frame = &p->frames[p->current];
+    if (p->gpuOpen && frame->marks > 0) {
+        glQueryCounter(frame->queries[frame->marks], GL_TIMESTAMP);
+        frame->marks++;
+        frame->pending = 1;
+    }
+
+    p->current = (p->current + 1) % PROFILER_FRAMES_IN_FLIGHT;
+    for (int f = 0; f < PROFILER_FRAMES_IN_FLIGHT; f++) {
+        if (f != p->current && p->frames[f].pending) collectFrame(p, &p->frames[f]);
+    }
+}
+
+static void printRow(const char* side, const char* name, const RollingStats* stats) {
+    StatsSummary s = statsSummarise(stats);
+    if (s.count == 0) return;
+    printf("%-4s %-9s %5d %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+           side, name, s.count, s.min, s.avg, s.p50, s.p99, s.max);
+}
+
+void printProfile(const Profiler* p) {
+    printf("%-4s %-9s %5s %9s %9s %9s %9s %9s\n", "", "stage", "n", "min ms", "avg ms", "p50 ms", "p99 ms", "max ms");
+    for (int s = 0; s < STAGE_COUNT; s++) printRow("cpu", STAGE_NAMES[s], &p->cpu[s]);
+    printRow("cpu", "frame", &p->cpuFrame);
+    for (int s = 0; s < STAGE_COUNT; s++) printRow("gpu", STAGE_NAMES[s], &p->gpu[s]);
+    printRow("gpu", "frame", &p->gpuFrame);
+}
+
+void resetProfilerStats(Profiler* p) {
+    memset(p->gpu, 0, sizeof(p->gpu));
+    memset(p->cpu, 0, sizeof(p->cpu));
+    memset(&p->gpuFrame, 0, sizeof(p->gpuFrame));
+    memset(&p->cpuFrame, 0, sizeof(p->cpuFrame));
+}
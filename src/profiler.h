@@ -0,0 +1,66 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+
+#include "stats.h"
+
+// Per-stage frame timings. GPU stages are bracketed with glQueryCounter
+// timestamps and read back PROFILER_FRAMES_IN_FLIGHT frames later, only once
+// the driver reports them available, so the frame loop never waits on them.
+// CPU stages are timed with platformTime. Both are also recorded as trace
+// events when tracing is on, GPU times shifted onto the CPU clock.
+
+#define PROFILER_FRAMES_IN_FLIGHT 4
+
+typedef enum {
+    STAGE_INPUT = 0,
+    STAGE_UPLOAD,
+    STAGE_BARRIER,
+    STAGE_DISPATCH,
+    STAGE_PRESENT,
+    STAGE_SWAP,
+    STAGE_COUNT
+} ProfileStage;
+
+typedef struct {
+    GLuint queries[STAGE_COUNT + 1];
+    ProfileStage stages[STAGE_COUNT];
+    int marks;
+    int pending;
+} GpuFrameQueries;
+
+typedef struct {
+    GpuFrameQueries frames[PROFILER_FRAMES_IN_FLIGHT];
+    int current;
+    int gpuOpen;
+    RollingStats gpu[STAGE_COUNT];
+    RollingStats cpu[STAGE_COUNT];
+    RollingStats gpuFrame;
+    RollingStats cpuFrame;
+    double frameStart;
+    double stageStart;
+    ProfileStage cpuStage;
+    int cpuOpen;
+    // platformTime() minus the GL timestamp, in seconds
+    double gpuClockOffset;
+} Profiler;
+
+const char* profileStageName(ProfileStage stage);
+
+void initProfiler(Profiler* p);
+void destroyProfiler(Profiler* p);
+
+// starts a frame; its GPU queries are skipped if the slot's last results are still in flight
+void profilerBeginFrame(Profiler* p);
+// ends the previous stage and starts stage, on the CPU and (if gpu) on the GPU
+void profilerStage(Profiler* p, ProfileStage stage, int gpu);
+// ends the frame and collects whichever earlier frames' GPU results are ready
+void profilerEndFrame(Profiler* p);
+
+void printProfile(const Profiler* p);
+// clears the timings, e.g. to time a reloaded kernel on its own; frames
+// still in flight land in the new stats
+void resetProfilerStats(Profiler* p);
+
+#endif
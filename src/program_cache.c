@@ -0,0 +1,144 @@
+#include "program_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.h"
+
+#define CACHE_MAGIC 0x4350424Du  // "MBPC"
+#define CACHE_VERSION 1u
+
+typedef struct {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int format;
+    unsigned int length;
+    unsigned long long key;
+} CacheHeader;
+
+// FNV-1a, the sources are hashed once per program so speed does not matter
+static unsigned long long hashBytes(unsigned long long h, const char* s) {
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 0x100000001B3ull;
+    }
+    // a separator so that ("ab","c") and ("a","bc") differ
+    h ^= 0xFF;
+    h *= 0x100000001B3ull;
+    return h;
+}
+
+void initProgramCache(ProgramCache* cache, const char* dir) {
+    memset(cache, 0, sizeof(*cache));
+    snprintf(cache->dir, sizeof(cache->dir), "%s", dir);
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    cache->enabled = formats > 0 && platformMakeDir(dir);
+
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    const char* version = (const char*)glGetString(GL_VERSION);
+    unsigned long long h = 0xCBF29CE484222325ull;
+    h = hashBytes(h, renderer ? renderer : "");
+    h = hashBytes(h, version ? version : "");
+    cache->driverHash = h;
+}
+
+unsigned long long programCacheKey(const ProgramCache* cache, const char* const* sources, int count) {
+    unsigned long long h = cache->driverHash;
+    for (int i = 0; i < count; i++) h = hashBytes(h, sources[i]);
+    return h;
+}
+
+static void cachePath(const ProgramCache* cache, unsigned long long key, char* out, size_t size) {
+    snprintf(out, size, "%s/%016llx.bin", cache->dir, key);
+}
+
+GLuint loadCachedProgram(ProgramCache* cache, unsigned long long key) {
+    if (!cache->enabled) return 0;
+    double start = platformTime();
+    char path[PROGRAM_CACHE_PATH_MAX + 32];
+    cachePath(cache, key, path, sizeof(path));
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        cache->misses++;
+        return 0;
+    }
+
+    CacheHeader header;
+    void* binary = NULL;
+    int ok = fread(&header, sizeof(header), 1, fp) == 1
+          && header.magic == CACHE_MAGIC && header.version == CACHE_VERSION
+          && header.key == key && header.length > 0
+          && (binary = malloc(header.length)) != NULL
+          && fread(binary, 1, header.length, fp) == header.length;
+    fclose(fp);
+
+    GLuint program = 0;
+    if (ok) {
+        program = glCreateProgram();
+        glProgramBinary(program, header.format, binary, (GLsizei)header.length);
+        GLint linked = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+    free(binary);
+    // an unknown binary format is reported as an error, not only a failed link
+    while (glGetError() != GL_NO_ERROR) {}
+
+    if (!program) {
+        // stale or corrupt, it is rewritten after the compile
+        remove(path);
+        cache->rejected++;
+        return 0;
+    }
+    cache->hits++;
+    cache->loadMs += (platformTime() - start) * 1000.0;
+    return program;
+}
+
+void storeCachedProgram(ProgramCache* cache, unsigned long long key, GLuint program) {
+    if (!cache->enabled || !program) return;
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+    void* binary = malloc((size_t)length);
+    if (!binary) return;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary);
+
+    char path[PROGRAM_CACHE_PATH_MAX + 32];
+    char temp[PROGRAM_CACHE_PATH_MAX + 36];
+    cachePath(cache, key, path, sizeof(path));
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    CacheHeader header = {CACHE_MAGIC, CACHE_VERSION, format, (unsigned int)length, key};
+    FILE* fp = fopen(temp, "wb");
+    int ok = fp
+          && fwrite(&header, sizeof(header), 1, fp) == 1
+          && fwrite(binary, 1, (size_t)length, fp) == (size_t)length;
+    if (fp && fclose(fp) != 0) ok = 0;
+    free(binary);
+
+    // written aside and renamed, so a concurrent or interrupted run never reads half a file
+    if (ok && rename(temp, path) != 0) {
+        // Windows will not rename over an existing file
+        remove(path);
+        ok = rename(temp, path) == 0;
+    }
+    if (!ok) {
+        remove(temp);
+        fprintf(stderr, "Failed to write %s\n", path);
+    }
+}
+
+void printProgramCache(const ProgramCache* cache) {
+    if (!cache->enabled) {
+        printf("program cache: off, %.1f ms compiling\n", cache->compileMs);
+        return;
+    }
+    printf("program cache: %d hits (%.1f ms), %d misses, %d rejected, %.1f ms compiling\n",
+           cache->hits, cache->loadMs, cache->misses, cache->rejected, cache->compileMs);
+}
@@ -0,0 +1,39 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+// On-disk cache of linked program binaries. A program is keyed on a hash of
+// its sources and of the renderer and driver version strings, so a driver
+// update or a shader edit misses instead of loading a stale binary. Binaries
+// the driver rejects are deleted and the caller compiles from source.
+
+#define PROGRAM_CACHE_DIR "shader_cache"
+#define PROGRAM_CACHE_PATH_MAX 512
+
+typedef struct {
+    char dir[PROGRAM_CACHE_PATH_MAX];
+    // hash of renderer and version, folded into every key
+    unsigned long long driverHash;
+    int enabled;
+    int hits;
+    int misses;
+    int rejected;
+    double loadMs;
+    double compileMs;
+} ProgramCache;
+
+// disabled when the driver has no binary formats or dir cannot be created
+void initProgramCache(ProgramCache* cache, const char* dir);
+
+// key of a program built from count sources
+unsigned long long programCacheKey(const ProgramCache* cache, const char* const* sources, int count);
+
+// returns the linked program, or 0 on a miss or a rejected binary
+GLuint loadCachedProgram(ProgramCache* cache, unsigned long long key);
+// writes the binary of a program linked with the retrievable hint set
+void storeCachedProgram(ProgramCache* cache, unsigned long long key, GLuint program);
+
+void printProgramCache(const ProgramCache* cache);
+
+#endif
@@ -0,0 +1,145 @@
+#include "render_target.h"
+
+#include <string.h>
+
+static int roundUp(int value) {
+    if (value < 1) value = 1;
+    return (value + TARGET_GRANULARITY - 1) / TARGET_GRANULARITY * TARGET_GRANULARITY;
+}
+
+// a texture fits if it is large enough without wasting more than one step per axis
+static int fits(const RenderTarget* t, int width, int height, GLenum format) {
+    return t->format == format
+        && t->capacityWidth >= width && t->capacityHeight >= height
+        && t->capacityWidth <= roundUp(width) + TARGET_GRANULARITY
+        && t->capacityHeight <= roundUp(height) + TARGET_GRANULARITY;
+}
+
+static RenderTarget createTarget(int width, int height, GLenum format) {
+    RenderTarget t = {0};
+    t.format = format;
+    t.capacityWidth = roundUp(width);
+    t.capacityHeight = roundUp(height);
+    glCreateTextures(GL_TEXTURE_2D, 1, &t.texture);
+    glTextureParameteri(t.texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(t.texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(t.texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(t.texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTextureStorage2D(t.texture, 1, format, t.capacityWidth, t.capacityHeight);
+    return t;
+}
+
+void initTargetPool(TargetPool* pool) {
+    memset(pool, 0, sizeof(*pool));
+}
+
+RenderTarget acquireTarget(TargetPool* pool, int width, int height, GLenum format) {
+    RenderTarget t;
+    int found = -1;
+    // newest first, it is the most likely to match the size being dragged to
+    for (int i = pool->count - 1; i >= 0; i--) {
+        if (fits(&pool->free[i], width, height, format)) {
+            found = i;
+            break;
+        }
+    }
+
+    if (found >= 0) {
+        t = pool->free[found];
+        memmove(&pool->free[found], &pool->free[found+1],
+                (size_t)(pool->count - found - 1) * sizeof(RenderTarget));
+        pool->count--;
+    } else {
+        t = createTarget(width, height, format);
+    }
+    t.width = width;
+    t.height = height;
+    return t;
+}
+
+void releaseTarget(TargetPool* pool, RenderTarget* target) {
+    if (!target->texture) return;
+    if (pool->count == TARGET_POOL_SIZE) {
+        glDeleteTextures(1, &pool->free[0].texture);
+        memmove(&pool->free[0], &pool->free[1], (TARGET_POOL_SIZE - 1) * sizeof(RenderTarget));
+        pool->count--;
+    }
+    pool->free[pool->count++] = *target;
+    target->texture = 0;
+}
+
+void destroyTargetPool(TargetPool* pool) {
+    for (int i = 0; i < pool->count; i++) glDeleteTextures(1, &pool->free[i].texture);
+    pool->count = 0;
+}
+
+void resizeTarget(TargetPool* pool, RenderTarget* target, int width, int height) {
+    if (target->texture && fits(target, width, height, target->format)) {
+        target->width = width;
+        target->height = height;
+        return;
+    }
+    GLenum format = target->format;
+    releaseTarget(pool, target);
+    *target = acquireTarget(pool, width, height, format);
+}
+
+void fitTarget(TargetPool* pool, RenderTarget* target, int width, int height, GLenum format) {
+    if (target->texture && target->format != format) releaseTarget(pool, target);
+    if (!target->texture) {
+        *target = acquireTarget(pool, width, height, format);
+    } else if (target->width != width || target->height != height) {
+        resizeTarget(pool, target, width, height);
+    }
+}
+
+void initRenderRing(RenderRing* ring, TargetPool* pool, int size,
+                    int width, int height, GLenum format) {
+    memset(ring, 0, sizeof(*ring));
+    if (size < 1) size = 1;
+    if (size > RENDER_RING_MAX) size = RENDER_RING_MAX;
+    ring->size = size;
+    for (int i = 0; i < size; i++) {
+        ring->targets[i] = acquireTarget(pool, width, height, format);
+    }
+}
+
+static void waitFence(GLsync* fence) {
+    if (!*fence) return;
+    while (glClientWaitSync(*fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+    glDeleteSync(*fence);
+    *fence = 0;
+}
+
+RenderTarget* beginRingFrame(RenderRing* ring, TargetPool* pool, int width, int height, GLenum format) {
+    RenderTarget* target = &ring->targets[ring->current];
+    waitFence(&ring->fences[ring->current]);
+    fitTarget(pool, target, width, height, format);
+    return target;
+}
+
+RenderTarget* ringPresentTarget(RenderRing* ring) {
+    if (ring->size == 1) return &ring->targets[ring->current];
+    if (ring->frames == 0) return NULL;
+    return &ring->targets[(ring->current + ring->size - 1) % ring->size];
+}
+
+void fenceRingPresent(RenderRing* ring) {
+    if (ring->size == 1 || ring->frames == 0) return;
+    int presented = (ring->current + ring->size - 1) % ring->size;
+    if (ring->fences[presented]) glDeleteSync(ring->fences[presented]);
+    ring->fences[presented] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void endRingFrame(RenderRing* ring) {
+    ring->current = (ring->current + 1) % ring->size;
+    ring->frames++;
+}
+
+void destroyRenderRing(RenderRing* ring, TargetPool* pool) {
+    for (int i = 0; i < ring->size; i++) {
+        waitFence(&ring->fences[i]);
+        releaseTarget(pool, &ring->targets[i]);
+    }
+    ring->size = 0;
+}
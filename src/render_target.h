@@ -0,0 +1,65 @@
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+#include <glad/glad.h>
+
+// Textures the compute kernel renders into. Storage is allocated in steps of
+// TARGET_GRANULARITY so that a window being dragged to a new size keeps
+// reusing the same texture; only the top-left width x height is rendered.
+
+#define TARGET_GRANULARITY 256
+#define TARGET_POOL_SIZE 4
+#define RENDER_RING_MAX 3
+
+typedef struct {
+    GLuint texture;
+    GLenum format;
+    int capacityWidth;
+    int capacityHeight;
+    int width;
+    int height;
+} RenderTarget;
+
+typedef struct {
+    RenderTarget free[TARGET_POOL_SIZE];
+    int count;
+} TargetPool;
+
+void initTargetPool(TargetPool* pool);
+// reuses a pooled texture large enough for width x height when there is one
+RenderTarget acquireTarget(TargetPool* pool, int width, int height, GLenum format);
+// hands the texture back to the pool, the least recently released is deleted when full
+void releaseTarget(TargetPool* pool, RenderTarget* target);
+void destroyTargetPool(TargetPool* pool);
+
+// resizes target in place, going through the pool when the storage is too small or too big
+void resizeTarget(TargetPool* pool, RenderTarget* target, int width, int height);
+// makes target width x height of format, acquiring one if it has no texture yet
+void fitTarget(TargetPool* pool, RenderTarget* target, int width, int height, GLenum format);
+
+// Ring of targets so that frame N+1 is computed while frame N is presented.
+// The present of frame N is issued before the dispatch of N+1 and fenced right
+// after, so the target is rendered into again once its present has run, not
+// once the frame that followed it has. A ring of one presents each target
+// after its own dispatch and needs no fence, GL keeps the two in order.
+typedef struct {
+    RenderTarget targets[RENDER_RING_MAX];
+    GLsync fences[RENDER_RING_MAX];
+    int size;
+    int current;
+    int frames;
+} RenderRing;
+
+void initRenderRing(RenderRing* ring, TargetPool* pool, int size,
+                    int width, int height, GLenum format);
+// waits until the next target is no longer read, resizes it and returns it
+RenderTarget* beginRingFrame(RenderRing* ring, TargetPool* pool, int width, int height, GLenum format);
+// the target finished last frame (this frame's with a ring of one), NULL if there is none yet
+RenderTarget* ringPresentTarget(RenderRing* ring);
+// fences the reads of ringPresentTarget issued so far, nothing with a ring of one
+void fenceRingPresent(RenderRing* ring);
+// moves on to the next target
+void endRingFrame(RenderRing* ring);
+void destroyRenderRing(RenderRing* ring, TargetPool* pool);
+
+#endif
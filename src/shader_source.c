@@ -0,0 +1,52 @@
+#include "shader_source.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "embedded_shaders.h"
+
+#define SHADER_PATH_MAX 512
+
+static const char* directory = NULL;
+
+void setShaderDirectory(const char* dir) {
+    directory = dir;
+}
+
+const char* shaderDirectory(void) {
+    return directory;
+}
+
+static char* readFile(const char* path) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) return NULL;
+    if (fseek(fp, 0, SEEK_END) != 0) { fclose(fp); return NULL; }
+    long size = ftell(fp);
+    if (size < 0) { fclose(fp); return NULL; }
+    rewind(fp);
+    char* content = malloc((size_t)size + 1);
+    if (!content) { fclose(fp); return NULL; }
+    content[fread(content, 1, (size_t)size, fp)] = '\0';
+    fclose(fp);
+    return content;
+}
+
+char* loadShaderSource(const char* name) {
+    if (directory) {
+        char path[SHADER_PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", directory, name);
+        char* source = readFile(path);
+        if (!source) fprintf(stderr, "Failed to read %s\n", path);
+        return source;
+    }
+    const char* embedded = embeddedShader(name);
+    if (!embedded) {
+        fprintf(stderr, "%s was not embedded in the build\n", name);
+        return NULL;
+    }
+    size_t length = strlen(embedded) + 1;
+    char* source = malloc(length);
+    if (source) memcpy(source, embedded, length);
+    return source;
+}
@@ -0,0 +1,18 @@
+#ifndef SHADER_SOURCE_H
+#define SHADER_SOURCE_H
+
+// Where shader sources come from. By default the copies embedded at build
+// time, so the binary runs from any directory; with a shader directory set
+// (the dev mode, --shader-dir) they are read from disk on every load.
+
+#define SHADER_DIR "shader"
+
+// NULL goes back to the embedded sources
+void setShaderDirectory(const char* dir);
+// the directory being read from, NULL when embedded
+const char* shaderDirectory(void);
+
+// malloc'd source of e.g. "compute_shader.glsl", NULL and a message if there is none
+char* loadShaderSource(const char* name);
+
+#endif
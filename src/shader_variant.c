@@ -0,0 +1,402 @@
+#include "shader_variant.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parallel_compile.h"
+#include "platform.h"
+
+// below this pixel size neighbouring pixels round to the same float
+#define DOUBLE_PRECISION_PIXEL_SIZE 1e-6
+// shallow renders spend more time in the rollback than they save
+#define UNROLL_MIN_DEPTH 64
+
+unsigned long long variantKey(const KernelVariant* v) {
+    return (unsigned long long)v->precision
+         | (unsigned long long)v->colour << 1
+         | (unsigned long long)(v->interiorCheck != 0) << 3
+         | (unsigned long long)v->unroll << 4
+         | (unsigned long long)v->localX << 12
+         | (unsigned long long)v->localY << 24
+         | (unsigned long long)v->output << 36
+         | (unsigned long long)v->reuse << 40;
+}
+
+GLenum outputInternalFormat(OutputFormat output) {
+    switch (output) {
+        case OUTPUT_R11G11B10F: return GL_R11F_G11F_B10F;
+        case OUTPUT_RGBA32F: return GL_RGBA32F;
+        default: return GL_RGBA8;
+    }
+}
+
+const char* outputLayoutName(OutputFormat output) {
+    switch (output) {
+        case OUTPUT_R11G11B10F: return "r11f_g11f_b10f";
+        case OUTPUT_RGBA32F: return "rgba32f";
+        default: return "rgba8";
+    }
+}
+
+int outputBytesPerPixel(OutputFormat output) {
+    return output == OUTPUT_RGBA32F ? 16 : 4;
+}
+
+int parseOutputFormat(const char* name, OutputFormat* out) {
+    for (int f = 0; f < OUTPUT_FORMAT_COUNT; f++) {
+        if (strcmp(name, outputLayoutName((OutputFormat)f)) == 0) {
+            *out = (OutputFormat)f;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+char* buildVariantSource(const char* source, const KernelVariant* v) {
+    char defines[320];
+    int definesLen = snprintf(defines, sizeof(defines),
+        "#define PRECISION_DOUBLE %d\n"
+        "#define LOCAL_X %d\n"
+        "#define LOCAL_Y %d\n"
+        "#define UNROLL %d\n"
+        "#define INTERIOR_CHECK %d\n"
+        "#define COLOUR_MODE %d\n"
+        "#define OUTPUT_FORMAT %s\n"
+        "#define REUSE %d\n",
+        v->precision == PRECISION_DOUBLE, v->localX, v->localY, v->unroll,
+        v->interiorCheck != 0, (int)v->colour, outputLayoutName(v->output), (int)v->reuse);
+
+    // #version has to stay the first line
+    size_t headerLen = 0;
+    if (strncmp(source, "#version", 8) == 0) {
+        const char* eol = strchr(source, '\n');
+        headerLen = eol ? (size_t)(eol - source) + 1 : strlen(source);
+    }
+
+    size_t sourceLen = strlen(source);
+    char* out = malloc(sourceLen + (size_t)definesLen + 2);
+    if (!out) return NULL;
+
+    char* p = out;
+    memcpy(p, source, headerLen);
+    p += headerLen;
+    if (headerLen && source[headerLen-1] != '\n') *p++ = '\n';
+    memcpy(p, defines, (size_t)definesLen);
+    p += definesLen;
+    memcpy(p, source + headerLen, sourceLen - headerLen + 1);
+    return out;
+}
+
+int setShaderVersion(char* source, int version) {
+    if (strncmp(source, "#version ", 9) != 0 || version < 100 || version > 999) return 0;
+    char* digits = source + 9;
+    for (int i = 0; i < 3; i++) {
+        if (digits[i] < '0' || digits[i] > '9') return 0;
+    }
+    char number[4];
+    snprintf(number, sizeof(number), "%d", version);
+    memcpy(digits, number, 3);
+    return 1;
+}
+
+// compile and link are only issued here, with parallel compile they run on driver threads
+static GLuint beginComputeProgram(const char* source, GLuint* shaderOut) {
+    GLuint computeShader = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(computeShader, 1, &source, NULL);
+    glCompileShader(computeShader);
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, computeShader);
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+    *shaderOut = computeShader;
+    return program;
+}
+
+// blocks until the link is done unless programLinkComplete said it is
+static GLuint finishComputeProgram(GLuint program, GLuint computeShader) {
+    GLint ok = 0;
+    glGetShaderiv(computeShader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char log[1024];
+        glGetShaderInfoLog(computeShader, sizeof(log), NULL, log);
+        fprintf(stderr, "Failed to compile compute shader:\n%s\n", log);
+    }
+    glDetachShader(program, computeShader);
+    glDeleteShader(computeShader);
+    if (!ok) {
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        char log[1024];
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        fprintf(stderr, "Failed to link compute program:\n%s\n", log);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+GLuint createComputeProgram(const char* source) {
+    GLuint computeShader;
+    GLuint program = beginComputeProgram(source, &computeShader);
+    return finishComputeProgram(program, computeShader);
+}
+
+void setSectionUniform(const KernelVariant* v, double ax, double ay, double bx, double by) {
+    if (v->precision == PRECISION_DOUBLE) {
+        glUniform4d(1, ax, ay, bx, by);
+    } else {
+        glUniform4f(1, (float)ax, (float)ay, (float)bx, (float)by);
+    }
+}
+
+void setReferenceUniform(const KernelVariant* v, double ax, double ay, double bx, double by) {
+    if (v->precision == PRECISION_DOUBLE) {
+        glUniform4d(4, ax, ay, bx, by);
+    } else {
+        glUniform4f(4, (float)ax, (float)ay, (float)bx, (float)by);
+    }
+}
+
+void dispatchVariant(const KernelVariant* v, int width, int height) {
+    glDispatchCompute((GLuint)(width + v->localX - 1) / v->localX,
+                      (GLuint)(height + v->localY - 1) / v->localY, 1);
+}
+
+// binding of the work list in the reuse passes
+#define REUSE_WORK_BINDING 2
+// the indirect dispatch and the count in front of the list
+#define REUSE_WORK_HEADER (4*sizeof(GLuint))
+
+void resetReuseWork(ReuseWork* work, int width, int height) {
+    size_t bytes = REUSE_WORK_HEADER + (size_t)width*height*sizeof(GLuint);
+    if (bytes > work->capacity) {
+        if (work->buffer) glDeleteBuffers(1, &work->buffer);
+        glCreateBuffers(1, &work->buffer);
+        glNamedBufferStorage(work->buffer, (GLsizeiptr)bytes, NULL, GL_DYNAMIC_STORAGE_BIT);
+        work->capacity = bytes;
+    }
+    const GLuint empty[4] = {0, 1, 1, 0};
+    glNamedBufferSubData(work->buffer, 0, sizeof(empty), empty);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, REUSE_WORK_BINDING, work->buffer);
+}
+
+void dispatchReuseFill(const ReuseWork* work) {
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, work->buffer);
+    glDispatchComputeIndirect(0);
+}
+
+void destroyReuseWork(ReuseWork* work) {
+    if (work->buffer) glDeleteBuffers(1, &work->buffer);
+    work->buffer = 0;
+    work->capacity = 0;
+}
+
+void initVariantCache(VariantCache* cache, const char* source) {
+    memset(cache, 0, sizeof(*cache));
+    cache->source = source;
+}
+
+static void addCompileTime(VariantCache* cache, double start) {
+    if (cache->binaries) cache->binaries->compileMs += (platformTime() - start) * 1000.0;
+}
+
+// takes a pending entry to ready or failed, waiting for the driver if block is set
+static void resolveEntry(VariantCache* cache, VariantEntry* e, int block) {
+    if (!e->shader) return;
+    if (!block && !programLinkComplete(e->program)) return;
+    double start = platformTime();
+    e->program = finishComputeProgram(e->program, e->shader);
+    e->shader = 0;
+    addCompileTime(cache, start);
+    if (cache->binaries) storeCachedProgram(cache->binaries, e->binaryKey, e->program);
+}
+
+static VariantStatus entryStatus(const VariantEntry* e, GLuint* program) {
+    *program = e->shader ? 0 : e->program;
+    if (e->shader) return VARIANT_PENDING;
+    return e->program ? VARIANT_READY : VARIANT_FAILED;
+}
+
+static void deleteEntry(VariantEntry* e) {
+    if (e->shader) glDeleteShader(e->shader);
+    if (e->program) glDeleteProgram(e->program);
+}
+
+// the slot for a new entry, the least recently used one's when full; a
+// compile in flight is only given up when every entry is one
+static VariantEntry* freeEntry(VariantCache* cache) {
+    if (cache->count < VARIANT_CACHE_SIZE) return &cache->entries[cache->count++];
+    VariantEntry* oldest = NULL;
+    for (int pending = 0; pending <= 1 && !oldest; pending++) {
+        for (int i = 0; i < cache->count; i++) {
+            VariantEntry* e = &cache->entries[i];
+            if ((e->shader != 0) != pending) continue;
+            if (!oldest || e->lastUsed < oldest->lastUsed) oldest = e;
+        }
+    }
+    deleteEntry(oldest);
+    return oldest;
+}
+
+VariantStatus requestVariantProgram(VariantCache* cache, const KernelVariant* v, GLuint* program) {
+    unsigned long long key = variantKey(v);
+    for (int i = 0; i < cache->count; i++) {
+        if (cache->entries[i].key == key) {
+            cache->entries[i].lastUsed = ++cache->uses;
+            resolveEntry(cache, &cache->entries[i], 0);
+            return entryStatus(&cache->entries[i], program);
+        }
+    }
+
+    VariantEntry e = {0};
+    e.key = key;
+    e.variant = *v;
+    e.lastUsed = ++cache->uses;
+    char* source = buildVariantSource(cache->source, v);
+    if (!source) {
+        *program = 0;
+        return VARIANT_FAILED;
+    }
+    if (cache->binaries) {
+        e.binaryKey = programCacheKey(cache->binaries, (const char* const*)&source, 1);
+        e.program = loadCachedProgram(cache->binaries, e.binaryKey);
+    }
+    if (!e.program) {
+        double start = platformTime();
+        e.program = beginComputeProgram(source, &e.shader);
+        addCompileTime(cache, start);
+    }
+    free(source);
+
+    // failures are cached too so a broken variant is not recompiled every frame
+    VariantEntry* stored = freeEntry(cache);
+    *stored = e;
+    resolveEntry(cache, stored, 0);
+    return entryStatus(stored, program);
+}
+
+GLuint getVariantProgram(VariantCache* cache, const KernelVariant* v) {
+    GLuint program;
+    if (requestVariantProgram(cache, v, &program) == VARIANT_PENDING) {
+        unsigned long long key = variantKey(v);
+        for (int i = 0; i < cache->count; i++) {
+            if (cache->entries[i].key != key) continue;
+            resolveEntry(cache, &cache->entries[i], 1);
+            entryStatus(&cache->entries[i], &program);
+        }
+    }
+    return program;
+}
+
+void releaseVariant(VariantCache* cache, const KernelVariant* v) {
+    unsigned long long key = variantKey(v);
+    for (int i = 0; i < cache->count; i++) {
+        if (cache->entries[i].key != key) continue;
+        deleteEntry(&cache->entries[i]);
+        cache->entries[i] = cache->entries[--cache->count];
+        return;
+    }
+}
+
+KernelVariant placeholderVariant(const KernelVariant* v) {
+    KernelVariant p = *v;
+    p.precision = PRECISION_FLOAT;
+    p.unroll = 1;
+    p.interiorCheck = 0;
+    return p;
+}
+
+KernelVariant reuseCopyVariant(const KernelVariant* v) {
+    KernelVariant c = *v;
+    c.unroll = 1;
+    c.interiorCheck = 0;
+    c.colour = COLOUR_PALETTE;
+    c.reuse = REUSE_COPY;
+    return c;
+}
+
+void prewarmVariants(VariantCache* cache, int localX, int localY, OutputFormat output) {
+    // without driver threads this would compile them all right here
+    if (!parallelCompileAvailable()) return;
+    // placeholders first, the driver tends to finish in submission order
+    for (int colour = 0; colour < COLOUR_MODE_COUNT; colour++) {
+        KernelVariant v = {PRECISION_FLOAT, localX, localY, DEFAULT_UNROLL, 0, (ColourMode)colour, output, REUSE_OFF};
+        KernelVariant p = placeholderVariant(&v);
+        GLuint program;
+        requestVariantProgram(cache, &p, &program);
+    }
+    for (int colour = 0; colour < COLOUR_MODE_COUNT; colour++) {
+        for (int precision = PRECISION_FLOAT; precision <= PRECISION_DOUBLE; precision++) {
+            for (int interior = 0; interior <= 1; interior++) {
+                for (int shallow = 0; shallow <= 1; shallow++) {
+                    KernelVariant v;
+                    v.precision = (KernelPrecision)precision;
+                    v.localX = localX;
+                    v.localY = localY;
+                    v.unroll = shallow ? 1 : DEFAULT_UNROLL;
+                    v.interiorCheck = interior;
+                    v.colour = (ColourMode)colour;
+                    v.output = output;
+                    v.reuse = REUSE_OFF;
+                    GLuint program;
+                    requestVariantProgram(cache, &v, &program);
+                }
+            }
+        }
+    }
+}
+
+int readyVariants(const VariantCache* cache, KernelVariant* out, int max) {
+    int count = 0;
+    for (int i = 0; i < cache->count && count < max; i++) {
+        if (!cache->entries[i].shader && cache->entries[i].program) out[count++] = cache->entries[i].variant;
+    }
+    return count;
+}
+
+void replaceVariantPrograms(VariantCache* cache, const char* source,
+                            const KernelVariant* variants, const GLuint* programs, int count) {
+    destroyVariantCache(cache);
+    cache->source = source;
+    for (int i = 0; i < count && i < VARIANT_CACHE_SIZE; i++) {
+        VariantEntry e = {0};
+        e.key = variantKey(&variants[i]);
+        e.variant = variants[i];
+        e.program = programs[i];
+        cache->entries[cache->count++] = e;
+    }
+}
+
+void destroyVariantCache(VariantCache* cache) {
+    for (int i = 0; i < cache->count; i++) deleteEntry(&cache->entries[i]);
+    cache->count = 0;
+}
+
+static int overlaps(double left, double bottom, double right, double top,
+                    double x0, double y0, double x1, double y1) {
+    return left < x1 && right > x0 && bottom < y1 && top > y0;
+}
+
+KernelVariant chooseVariant(double left, double bottom, double right, double top,
+                            double pixelSize, double depth, ColourMode colour,
+                            OutputFormat output) {
+    KernelVariant v;
+    v.precision = pixelSize < DOUBLE_PRECISION_PIXEL_SIZE ? PRECISION_DOUBLE : PRECISION_FLOAT;
+    v.localX = DEFAULT_LOCAL_X;
+    v.localY = DEFAULT_LOCAL_Y;
+    v.unroll = depth < UNROLL_MIN_DEPTH ? 1 : DEFAULT_UNROLL;
+    // bounding boxes of the main cardioid and the period-2 bulb
+    v.interiorCheck = overlaps(left, bottom, right, top, -0.75, -0.65, 0.375, 0.65)
+                   || overlaps(left, bottom, right, top, -1.25, -0.25, -0.75, 0.25);
+    v.colour = colour;
+    v.output = output;
+    v.reuse = REUSE_OFF;
+    return v;
+}
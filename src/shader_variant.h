@@ -0,0 +1,157 @@
+#ifndef SHADER_VARIANT_H
+#define SHADER_VARIANT_H
+
+#include <stddef.h>
+#include <glad/glad.h>
+
+#include "program_cache.h"
+
+// Compile-time specialisations of shader/compute_shader.glsl. Each field
+// becomes a #define inserted after the #version line, so the kernel has no
+// runtime branches on any of them.
+
+typedef enum {
+    PRECISION_FLOAT = 0,
+    PRECISION_DOUBLE = 1
+} KernelPrecision;
+
+typedef enum {
+    COLOUR_PALETTE = 0,
+    COLOUR_SMOOTH = 1,
+    COLOUR_GREY = 2,
+    COLOUR_MODE_COUNT
+} ColourMode;
+
+// format of the image the kernel writes, RGBA32F costs 4x the bandwidth of RGBA8
+typedef enum {
+    OUTPUT_RGBA8 = 0,
+    OUTPUT_R11G11B10F = 1,
+    OUTPUT_RGBA32F = 2,
+    OUTPUT_FORMAT_COUNT
+} OutputFormat;
+
+// animated zooms render in two passes over an earlier frame, the reference:
+// REUSE_COPY takes every pixel the reference has a sample for within half a
+// pixel and lists the others in a ReuseWork buffer, REUSE_FILL iterates just
+// those, dispatched indirectly so that no invocation sits idle
+typedef enum {
+    REUSE_OFF = 0,
+    REUSE_COPY = 1,
+    REUSE_FILL = 2
+} ReuseMode;
+
+typedef struct {
+    KernelPrecision precision;
+    int localX;
+    int localY;
+    int unroll;
+    int interiorCheck;
+    ColourMode colour;
+    OutputFormat output;
+    ReuseMode reuse;
+} KernelVariant;
+
+#define DEFAULT_LOCAL_X 8
+#define DEFAULT_LOCAL_Y 4
+#define DEFAULT_UNROLL 4
+
+// once full, the least recently requested variant is deleted for a new one
+#define VARIANT_CACHE_SIZE 64
+
+typedef struct {
+    unsigned long long key;
+    KernelVariant variant;
+    GLuint program;
+    // set while the compile is in flight
+    GLuint shader;
+    unsigned long long binaryKey;
+    unsigned long long lastUsed;
+} VariantEntry;
+
+typedef enum {
+    VARIANT_READY = 0,
+    VARIANT_PENDING,
+    VARIANT_FAILED
+} VariantStatus;
+
+typedef struct {
+    const char* source;
+    // optional, NULL compiles every variant from source
+    ProgramCache* binaries;
+    VariantEntry entries[VARIANT_CACHE_SIZE];
+    int count;
+    // request counter, the entries' lastUsed
+    unsigned long long uses;
+} VariantCache;
+
+unsigned long long variantKey(const KernelVariant* v);
+
+GLenum outputInternalFormat(OutputFormat output);
+// GLSL layout qualifier for the image, e.g. "rgba8"
+const char* outputLayoutName(OutputFormat output);
+int outputBytesPerPixel(OutputFormat output);
+// parses a layout name, returns 0 if it is not one of the formats
+int parseOutputFormat(const char* name, OutputFormat* out);
+
+// returns a malloc'd copy of source with the variant's defines after #version
+char* buildVariantSource(const char* source, const KernelVariant* v);
+
+// rewrites the number of a leading "#version NNN" in place, e.g. to run the
+// 460 kernels on a 4.5 context; returns 0 if there is no such line
+int setShaderVersion(char* source, int version);
+
+// compiles and links a compute program, returns 0 and prints the log on failure;
+// the program is linked retrievable so its binary can be cached
+GLuint createComputeProgram(const char* source);
+
+// uploads the view section at location 1 with the variant's precision
+void setSectionUniform(const KernelVariant* v, double ax, double ay, double bx, double by);
+// uploads the reference frame's section at location 4, for REUSE_COPY
+void setReferenceUniform(const KernelVariant* v, double ax, double ay, double bx, double by);
+// dispatches enough workgroups of the variant's size to cover width x height
+void dispatchVariant(const KernelVariant* v, int width, int height);
+
+typedef struct {
+    GLuint buffer;
+    size_t capacity;
+} ReuseWork;
+
+// empties the work list, grown to width x height pixels, and binds it for both passes
+void resetReuseWork(ReuseWork* work, int width, int height);
+// the REUSE_FILL pass over what the bound REUSE_COPY pass listed
+void dispatchReuseFill(const ReuseWork* work);
+void destroyReuseWork(ReuseWork* work);
+
+void initVariantCache(VariantCache* cache, const char* source);
+// starts compiling the variant on first use, or loads it from the binary
+// cache, and never waits for the driver; program is set when READY
+VariantStatus requestVariantProgram(VariantCache* cache, const KernelVariant* v, GLuint* program);
+// like requestVariantProgram but waits for the compile, returns 0 if it fails
+GLuint getVariantProgram(VariantCache* cache, const KernelVariant* v);
+// deletes the variant's program, e.g. a candidate autotune did not pick
+void releaseVariant(VariantCache* cache, const KernelVariant* v);
+// requests every colour, precision, interior check and shallow/deep unroll for
+// one workgroup size and output, so they compile while the first frames run;
+// does nothing without parallel compile
+void prewarmVariants(VariantCache* cache, int localX, int localY, OutputFormat output);
+// the cheapest variant with the same colouring, what is shown while v compiles
+KernelVariant placeholderVariant(const KernelVariant* v);
+// the REUSE_COPY pass of v; it neither iterates nor colours, so the one
+// program serves every colour mode, unroll and interior check
+KernelVariant reuseCopyVariant(const KernelVariant* v);
+
+// the variants that have compiled, e.g. to rebuild them from an edited source
+int readyVariants(const VariantCache* cache, KernelVariant* out, int max);
+// swaps in a new source with programs built from it (by a reload); every old
+// program is deleted and variants not in the list compile again on first use
+void replaceVariantPrograms(VariantCache* cache, const char* source,
+                            const KernelVariant* variants, const GLuint* programs, int count);
+void destroyVariantCache(VariantCache* cache);
+
+// picks the cheapest variant that renders the view correctly
+// pixelSize is the width of one pixel in the complex plane
+KernelVariant chooseVariant(double left, double bottom, double right, double top,
+                            double pixelSize, double depth, ColourMode colour,
+                            OutputFormat output);
+
+#endif
@@ -0,0 +1,102 @@
+#include "shader_watch.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include <sys/stat.h>
+
+#include "platform.h"
+#endif
+
+#ifdef __linux__
+
+static int nameIndex(const ShaderWatch* w, const char* name) {
+    for (int i = 0; i < w->count; i++) {
+        if (strcmp(w->names[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+int initShaderWatch(ShaderWatch* w, const char* dir, const char* const* names, int count) {
+    memset(w, 0, sizeof(*w));
+    snprintf(w->dir, sizeof(w->dir), "%s", dir);
+    for (int i = 0; i < count && i < SHADER_WATCH_MAX; i++) {
+        snprintf(w->names[i], SHADER_WATCH_NAME_MAX, "%s", names[i]);
+        w->count++;
+    }
+    w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (w->fd < 0) return 0;
+    if (inotify_add_watch(w->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+        close(w->fd);
+        w->fd = -1;
+        return 0;
+    }
+    return 1;
+}
+
+unsigned pollShaderWatch(ShaderWatch* w) {
+    unsigned changed = 0;
+    if (w->fd < 0) return 0;
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;) {
+        ssize_t length = read(w->fd, buffer, sizeof(buffer));
+        if (length <= 0) break;
+        for (char* p = buffer; p < buffer + length; ) {
+            const struct inotify_event* event = (const struct inotify_event*)p;
+            int i = event->len ? nameIndex(w, event->name) : -1;
+            if (i >= 0) changed |= 1u << i;
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+    return changed;
+}
+
+void destroyShaderWatch(ShaderWatch* w) {
+    if (w->fd >= 0) close(w->fd);
+    w->fd = -1;
+}
+
+#else
+
+static long long modifiedTime(const ShaderWatch* w, int i) {
+    char path[sizeof(w->dir) + SHADER_WATCH_NAME_MAX + 1];
+    snprintf(path, sizeof(path), "%s/%s", w->dir, w->names[i]);
+    struct stat st;
+    return stat(path, &st) == 0 ? (long long)st.st_mtime : -1;
+}
+
+int initShaderWatch(ShaderWatch* w, const char* dir, const char* const* names, int count) {
+    memset(w, 0, sizeof(*w));
+    snprintf(w->dir, sizeof(w->dir), "%s", dir);
+    for (int i = 0; i < count && i < SHADER_WATCH_MAX; i++) {
+        snprintf(w->names[i], SHADER_WATCH_NAME_MAX, "%s", names[i]);
+        w->count++;
+        w->mtimes[i] = modifiedTime(w, i);
+    }
+    return 1;
+}
+
+unsigned pollShaderWatch(ShaderWatch* w) {
+    unsigned changed = 0;
+    double now = platformTime();
+    if (now < w->nextPoll) return 0;
+    w->nextPoll = now + SHADER_WATCH_POLL_SECONDS;
+    for (int i = 0; i < w->count; i++) {
+        long long mtime = modifiedTime(w, i);
+        if (mtime != w->mtimes[i]) {
+            w->mtimes[i] = mtime;
+            changed |= 1u << i;
+        }
+    }
+    return changed;
+}
+
+void destroyShaderWatch(ShaderWatch* w) {
+    w->count = 0;
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef SHADER_WATCH_H
+#define SHADER_WATCH_H
+
+// Notices when shader files in a directory are saved. On Linux an inotify
+// watch on the directory, so editors that save through a rename are seen
+// too; elsewhere the modification times are polled every
+// SHADER_WATCH_POLL_SECONDS.
+
+#define SHADER_WATCH_MAX 4
+#define SHADER_WATCH_NAME_MAX 64
+#define SHADER_WATCH_POLL_SECONDS 0.25
+
+typedef struct {
+    char dir[512];
+    char names[SHADER_WATCH_MAX][SHADER_WATCH_NAME_MAX];
+    int count;
+#ifdef __linux__
+    int fd;
+#else
+    long long mtimes[SHADER_WATCH_MAX];
+    double nextPoll;
+#endif
+} ShaderWatch;
+
+// watches names (file names inside dir), returns 0 if the watch cannot be set up
+int initShaderWatch(ShaderWatch* w, const char* dir, const char* const* names, int count);
+// bit i is set when names[i] changed since the last call, never blocks
+unsigned pollShaderWatch(ShaderWatch* w);
+void destroyShaderWatch(ShaderWatch* w);
+
+#endif
@@ -0,0 +1,42 @@
+#include "stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void statsPush(RollingStats* stats, double value) {
+    stats->samples[stats->next] = value;
+    stats->next = (stats->next + 1) % STATS_WINDOW;
+    if (stats->count < STATS_WINDOW) stats->count++;
+}
+
+static int compareDouble(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// nearest rank on the sorted window
+static double percentile(const double* sorted, int count, double p) {
+    int rank = (int)(p * count + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return sorted[rank - 1];
+}
+
+StatsSummary statsSummarise(const RollingStats* stats) {
+    StatsSummary s = {0};
+    s.count = stats->count;
+    if (stats->count == 0) return s;
+
+    double sorted[STATS_WINDOW];
+    memcpy(sorted, stats->samples, (size_t)stats->count * sizeof(double));
+    qsort(sorted, (size_t)stats->count, sizeof(double), compareDouble);
+
+    double sum = 0.0;
+    for (int i = 0; i < stats->count; i++) sum += sorted[i];
+    s.min = sorted[0];
+    s.max = sorted[stats->count - 1];
+    s.avg = sum / stats->count;
+    s.p50 = percentile(sorted, stats->count, 0.50);
+    s.p99 = percentile(sorted, stats->count, 0.99);
+    return s;
+}
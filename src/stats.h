@@ -0,0 +1,25 @@
+#ifndef STATS_H
+#define STATS_H
+
+// The last STATS_WINDOW samples of a measurement, in milliseconds.
+#define STATS_WINDOW 256
+
+typedef struct {
+    double samples[STATS_WINDOW];
+    int count;
+    int next;
+} RollingStats;
+
+typedef struct {
+    int count;
+    double min;
+    double avg;
+    double p50;
+    double p99;
+    double max;
+} StatsSummary;
+
+void statsPush(RollingStats* stats, double value);
+StatsSummary statsSummarise(const RollingStats* stats);
+
+#endif
@@ -0,0 +1,135 @@
+#include "tile_cache.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_ENTRY (-1)
+
+static unsigned long long mix(unsigned long long h, unsigned long long v) {
+    h ^= v + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+    return h;
+}
+
+unsigned long long tileKeyHash(const TileKey* key) {
+    unsigned long long h = (unsigned long long)key->level;
+    h = mix(h, (unsigned long long)key->tx);
+    h = mix(h, (unsigned long long)key->ty);
+    h = mix(h, (unsigned long long)key->depth);
+    h = mix(h, (unsigned long long)key->formula);
+    h = mix(h, (unsigned long long)key->precision);
+    // finaliser of splitmix64, the low bits pick the bucket
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBull;
+    return h ^ (h >> 31);
+}
+
+static int sameKey(const TileKey* a, const TileKey* b) {
+    return a->level == b->level && a->tx == b->tx && a->ty == b->ty &&
+           a->depth == b->depth && a->formula == b->formula && a->precision == b->precision;
+}
+
+int initTileCache(TileCache* cache, size_t budgetBytes) {
+    memset(cache, 0, sizeof(*cache));
+    cache->capacity = (int)(budgetBytes / (TILE_BYTES + sizeof(TileEntry)));
+    if (cache->capacity < 1) return 0;
+    cache->bucketCount = 1;
+    while (cache->bucketCount < 2*cache->capacity) cache->bucketCount *= 2;
+    cache->entries = calloc((size_t)cache->capacity, sizeof(TileEntry));
+    cache->buckets = malloc((size_t)cache->bucketCount * sizeof(int));
+    if (!cache->entries || !cache->buckets) {
+        destroyTileCache(cache);
+        return 0;
+    }
+    for (int i = 0; i < cache->bucketCount; i++) cache->buckets[i] = NO_ENTRY;
+    cache->head = cache->tail = NO_ENTRY;
+    return 1;
+}
+
+static void unlinkLru(TileCache* cache, int i) {
+    TileEntry* e = &cache->entries[i];
+    if (e->prev != NO_ENTRY) cache->entries[e->prev].next = e->next;
+    else cache->head = e->next;
+    if (e->next != NO_ENTRY) cache->entries[e->next].prev = e->prev;
+    else cache->tail = e->prev;
+}
+
+static void pushLru(TileCache* cache, int i) {
+    TileEntry* e = &cache->entries[i];
+    e->prev = NO_ENTRY;
+    e->next = cache->head;
+    if (cache->head != NO_ENTRY) cache->entries[cache->head].prev = i;
+    cache->head = i;
+    if (cache->tail == NO_ENTRY) cache->tail = i;
+}
+
+static int* bucketOf(TileCache* cache, const TileKey* key) {
+    return &cache->buckets[tileKeyHash(key) & (unsigned long long)(cache->bucketCount - 1)];
+}
+
+int* findTile(TileCache* cache, const TileKey* key) {
+    for (int i = *bucketOf(cache, key); i != NO_ENTRY; i = cache->entries[i].chain) {
+        if (sameKey(&cache->entries[i].key, key)) {
+            unlinkLru(cache, i);
+            pushLru(cache, i);
+            cache->hits++;
+            return cache->entries[i].iters;
+        }
+    }
+    cache->misses++;
+    return NULL;
+}
+
+int* insertTile(TileCache* cache, const TileKey* key) {
+    int i;
+    if (cache->count < cache->capacity) {
+        i = cache->count;
+        cache->entries[i].iters = malloc(TILE_BYTES);
+        if (!cache->entries[i].iters) return NULL;
+        cache->count++;
+    } else {
+        // reuse the buffer of the least recently used tile
+        i = cache->tail;
+        unlinkLru(cache, i);
+        int* link = bucketOf(cache, &cache->entries[i].key);
+        while (*link != i) link = &cache->entries[*link].chain;
+        *link = cache->entries[i].chain;
+        cache->evictions++;
+    }
+    TileEntry* e = &cache->entries[i];
+    e->key = *key;
+    int* bucket = bucketOf(cache, key);
+    e->chain = *bucket;
+    *bucket = i;
+    pushLru(cache, i);
+    return e->iters;
+}
+
+void destroyTileCache(TileCache* cache) {
+    for (int i = 0; i < cache->count; i++) free(cache->entries[i].iters);
+    free(cache->entries);
+    free(cache->buckets);
+    memset(cache, 0, sizeof(*cache));
+}
+
+void printTileCache(const TileCache* cache) {
+    unsigned long long lookups = cache->hits + cache->misses;
+    printf("tile cache: %d of %d tiles (%.1f MB), %llu hits, %llu misses (%.1f%% hit rate), %llu evicted\n",
+           cache->count, cache->capacity, (double)cache->count*TILE_BYTES/(1024.0*1024.0),
+           cache->hits, cache->misses, lookups ? 100.0*cache->hits/lookups : 0.0,
+           cache->evictions);
+}
+
+int tileLevelForPixel(double pixelSize) {
+    // rounded up, a coarser level would render the view below its resolution;
+    // the slack keeps an exact power of two from going one level deeper
+    int level = (int)ceil(log2(TILE_ROOT_SPAN / (TILE_SIZE*pixelSize)) - 1e-9);
+    return level > 0 ? level : 0;
+}
+
+double tileSpan(int level) {
+    return ldexp(TILE_ROOT_SPAN, -level);
+}
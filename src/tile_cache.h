@@ -0,0 +1,74 @@
+#ifndef TILE_CACHE_H
+#define TILE_CACHE_H
+
+#include <stddef.h>
+
+// In-memory cache of iteration-count tiles, so going back to a place that
+// was rendered before does not recompute it. Tiles sit on a quadtree over the
+// complex plane: level 0 is one TILE_ROOT_SPAN square whose bottom-left corner
+// is (TILE_ROOT_X, TILE_ROOT_Y), and every level halves the tile side. A tile
+// is TILE_SIZE x TILE_SIZE iteration counts sampled at its pixel corners, row
+// 0 at the bottom like the CPU and GL images. Least recently used tiles are
+// evicted once the memory budget is reached.
+
+#define TILE_SIZE 64
+#define TILE_ROOT_X (-2.5)
+#define TILE_ROOT_Y (-2.0)
+#define TILE_ROOT_SPAN 4.0
+#define TILE_BYTES ((size_t)TILE_SIZE * TILE_SIZE * sizeof(int))
+
+// the iteration a tile was computed with, there is only the one so far
+#define TILE_FORMULA_MANDELBROT 0
+
+typedef struct {
+    int level;
+    long long tx;
+    long long ty;
+    int depth;
+    int formula;
+    // 0 float, 1 double, the KernelPrecision numbering
+    int precision;
+} TileKey;
+
+typedef struct {
+    TileKey key;
+    int* iters;
+    // LRU list, head is the most recently used
+    int prev;
+    int next;
+    // next entry in the same hash bucket
+    int chain;
+} TileEntry;
+
+typedef struct {
+    TileEntry* entries;
+    int capacity;
+    int count;
+    int* buckets;
+    int bucketCount;
+    int head;
+    int tail;
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+} TileCache;
+
+unsigned long long tileKeyHash(const TileKey* key);
+
+// holds as many tiles as fit in budgetBytes, returns 0 if that is not even one
+int initTileCache(TileCache* cache, size_t budgetBytes);
+// the tile's iterations or NULL, a hit becomes the most recently used
+int* findTile(TileCache* cache, const TileKey* key);
+// adds a tile for key and returns its buffer for the caller to fill, evicting
+// the least recently used tile when full; NULL if memory runs out
+int* insertTile(TileCache* cache, const TileKey* key);
+void destroyTileCache(TileCache* cache);
+void printTileCache(const TileCache* cache);
+
+// the coarsest level whose tile pixels are no larger than pixelSize, so within
+// a factor of 2 smaller
+int tileLevelForPixel(double pixelSize);
+// side of a tile at level
+double tileSpan(int level);
+
+#endif
@@ -0,0 +1,204 @@
+#include "tile_store.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define STORE_MAGIC "MBTS"
+#define STORE_VERSION 2u
+#define STATE_NEW 0u
+#define STATE_CREATING 1u
+#define STATE_READY 2u
+#define DATA_ALIGNMENT 4096
+
+static size_t slotsOffset(void) {
+    return (sizeof(TileStoreHeader) + 63) & ~(size_t)63;
+}
+
+static size_t dataOffset(uint32_t slotCount) {
+    size_t end = slotsOffset() + (size_t)slotCount * sizeof(TileStoreSlot);
+    return (end + DATA_ALIGNMENT - 1) & ~(size_t)(DATA_ALIGNMENT - 1);
+}
+
+static size_t storeBytes(uint32_t slotCount) {
+    return dataOffset(slotCount) + (size_t)slotCount * TILE_BYTES;
+}
+
+// the most whole sets that fit in bytes
+static uint32_t slotsForBytes(size_t bytes) {
+    size_t perSlot = TILE_BYTES + sizeof(TileStoreSlot);
+    uint32_t count = (uint32_t)(bytes / perSlot) / TILE_STORE_WAYS * TILE_STORE_WAYS;
+    while (count > 0 && storeBytes(count) > bytes) count -= TILE_STORE_WAYS;
+    return count;
+}
+
+int openTileStore(TileStore* store, const char* path, double sizeMb) {
+    memset(store, 0, sizeof(*store));
+    size_t bytes = (size_t)(sizeMb * 1024.0 * 1024.0);
+    if (slotsForBytes(bytes) == 0) {
+        fprintf(stderr, "%s: %.1f MB is too small for a tile store\n", path, sizeMb);
+        return 0;
+    }
+    if (!platformMapFile(&store->file, path, bytes)) {
+        fprintf(stderr, "Failed to map %s\n", path);
+        return 0;
+    }
+    TileStoreHeader* header = store->file.data;
+
+    // whoever finds the file new lays it out under the file lock, everyone
+    // else waits for the lock; a file still being created once the lock is
+    // free was left by a creator that died, and is laid out again
+    if (!platformLockFile(&store->file)) {
+        fprintf(stderr, "Failed to lock %s\n", path);
+        platformUnmapFile(&store->file);
+        return 0;
+    }
+    uint32_t state = atomic_load_explicit(&header->state, memory_order_acquire);
+    if (state == STATE_NEW || state == STATE_CREATING) {
+        atomic_store_explicit(&header->state, STATE_CREATING, memory_order_relaxed);
+        memcpy(header->magic, STORE_MAGIC, 4);
+        header->version = STORE_VERSION;
+        header->tileSize = TILE_SIZE;
+        header->slotCount = slotsForBytes(store->file.size);
+        atomic_store_explicit(&header->state, STATE_READY, memory_order_release);
+    }
+    platformUnlockFile(&store->file);
+    if (atomic_load_explicit(&header->state, memory_order_acquire) != STATE_READY ||
+        memcmp(header->magic, STORE_MAGIC, 4) != 0 || header->version != STORE_VERSION ||
+        header->tileSize != TILE_SIZE || header->slotCount == 0 ||
+        storeBytes(header->slotCount) > store->file.size) {
+        fprintf(stderr, "%s is not a tile store of this version, delete it to start over\n", path);
+        platformUnmapFile(&store->file);
+        return 0;
+    }
+
+    store->header = header;
+    store->slotCount = header->slotCount;
+    store->slots = (TileStoreSlot*)((unsigned char*)store->file.data + slotsOffset());
+    store->data = (unsigned char*)store->file.data + dataOffset(store->slotCount);
+    return 1;
+}
+
+static uint32_t firstSlot(const TileStore* store, const TileKey* key) {
+    uint32_t sets = store->slotCount / TILE_STORE_WAYS;
+    return (uint32_t)(tileKeyHash(key) % sets) * TILE_STORE_WAYS;
+}
+
+static int slotHolds(const TileStoreSlot* slot, const TileKey* key) {
+    return slot->level == key->level && slot->tx == key->tx && slot->ty == key->ty &&
+           slot->depth == key->depth && slot->formula == key->formula &&
+           slot->precision == key->precision;
+}
+
+static void touchSlot(TileStore* store, TileStoreSlot* slot) {
+    uint64_t now = atomic_fetch_add_explicit(&store->header->clock, 1, memory_order_relaxed) + 1;
+    atomic_store_explicit(&slot->lastUse, now, memory_order_relaxed);
+}
+
+int findStoredTile(TileStore* store, const TileKey* key, StoredTile* out) {
+    uint32_t base = firstSlot(store, key);
+    for (uint32_t i = base; i < base + TILE_STORE_WAYS; i++) {
+        TileStoreSlot* slot = &store->slots[i];
+        uint32_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        if (sequence == 0 || (sequence & 1u)) continue;
+        int match = slotHolds(slot, key);
+        // the key is only trusted if no writer started while it was compared
+        atomic_thread_fence(memory_order_acquire);
+        if (!match || atomic_load_explicit(&slot->sequence, memory_order_relaxed) != sequence) continue;
+        touchSlot(store, slot);
+        out->iters = (const int*)(store->data + (size_t)i * TILE_BYTES);
+        out->slot = i;
+        out->sequence = sequence;
+        store->hits++;
+        atomic_fetch_add_explicit(&store->header->hits, 1, memory_order_relaxed);
+        return 1;
+    }
+    store->misses++;
+    atomic_fetch_add_explicit(&store->header->misses, 1, memory_order_relaxed);
+    return 0;
+}
+
+int tileStillValid(TileStore* store, const StoredTile* tile) {
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&store->slots[tile->slot].sequence, memory_order_relaxed) == tile->sequence) {
+        return 1;
+    }
+    store->raced++;
+    return 0;
+}
+
+static uint64_t storeMicroseconds(void) {
+    return (uint64_t)(platformTime() * 1e6);
+}
+
+// odd for longer than any write takes, its writer died; a start later than
+// now is from before the machine restarted
+static int writerGone(const TileStoreSlot* slot, uint64_t now) {
+    uint64_t start = atomic_load_explicit(&slot->writeStart, memory_order_relaxed);
+    return start > now || now - start > (uint64_t)(TILE_STORE_STALE_SECONDS * 1e6);
+}
+
+void storeTile(TileStore* store, const TileKey* key, const int* iters) {
+    uint32_t base = firstSlot(store, key);
+    uint64_t now = storeMicroseconds();
+    // an empty or abandoned slot, else the least recently used one nobody is writing
+    uint32_t victim = 0;
+    uint32_t victimSequence = 0;
+    uint64_t oldest = UINT64_MAX;
+    int found = 0;
+    for (uint32_t i = base; i < base + TILE_STORE_WAYS; i++) {
+        TileStoreSlot* slot = &store->slots[i];
+        uint32_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        if (sequence == 0 || ((sequence & 1u) && writerGone(slot, now))) {
+            victim = i;
+            victimSequence = sequence;
+            found = 1;
+            break;
+        }
+        if (sequence & 1u) continue;
+        // another process got there first
+        if (slotHolds(slot, key)) return;
+        uint64_t lastUse = atomic_load_explicit(&slot->lastUse, memory_order_relaxed);
+        if (lastUse < oldest) {
+            oldest = lastUse;
+            victim = i;
+            victimSequence = sequence;
+            found = 1;
+        }
+    }
+    if (!found) return;
+
+    TileStoreSlot* slot = &store->slots[victim];
+    // stamped first, so a slot is never odd with the start of an earlier write;
+    // an abandoned one stays odd, but with a number its old writer cannot publish
+    uint32_t writing = victimSequence & 1u ? victimSequence + 2 : victimSequence + 1;
+    atomic_store_explicit(&slot->writeStart, storeMicroseconds(), memory_order_relaxed);
+    if (!atomic_compare_exchange_strong(&slot->sequence, &victimSequence, writing)) return;
+    slot->level = key->level;
+    slot->depth = key->depth;
+    slot->formula = key->formula;
+    slot->precision = key->precision;
+    slot->tx = key->tx;
+    slot->ty = key->ty;
+    memcpy(store->data + (size_t)victim * TILE_BYTES, iters, TILE_BYTES);
+    touchSlot(store, slot);
+    // fails only if this write stalled so long that another writer took over
+    if (!atomic_compare_exchange_strong_explicit(&slot->sequence, &writing, writing + 1,
+                                                 memory_order_release, memory_order_relaxed)) return;
+    store->stored++;
+}
+
+void closeTileStore(TileStore* store) {
+    if (store->header) platformUnmapFile(&store->file);
+    memset(store, 0, sizeof(*store));
+}
+
+void printTileStore(const TileStore* store) {
+    unsigned long long lookups = store->hits + store->misses;
+    unsigned long long allHits = atomic_load(&store->header->hits);
+    unsigned long long allLookups = allHits + atomic_load(&store->header->misses);
+    printf("tile store: %llu hits, %llu misses (%.1f%% hit rate), %llu stored, %llu raced; "
+           "%.1f%% hit rate over all runs, %u slots (%.1f MB)\n",
+           store->hits, store->misses, lookups ? 100.0*store->hits/lookups : 0.0,
+           store->stored, store->raced, allLookups ? 100.0*allHits/allLookups : 0.0,
+           store->slotCount, (double)store->file.size/(1024.0*1024.0));
+}
@@ -0,0 +1,93 @@
+#ifndef TILE_STORE_H
+#define TILE_STORE_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "platform.h"
+#include "tile_cache.h"
+
+// Tiles kept on disk between runs, in one memory-mapped file that any number
+// of renderer processes use at the same time. The file is a header, an index
+// of slot headers and the tile data, one TILE_BYTES slot per index entry. A
+// key hashes to a set of TILE_STORE_WAYS slots and replaces the least
+// recently used one. Slots are guarded by a sequence number instead of a
+// lock: a writer makes it odd while it writes, and a reader uses the tile
+// straight from the mapping and checks afterwards that the number did not
+// change under it. A writer that dies mid-write leaves its slot odd; once that
+// has lasted TILE_STORE_STALE_SECONDS another writer takes the slot over.
+
+#define TILE_STORE_DEFAULT_MB 256
+#define TILE_STORE_WAYS 8
+// far longer than copying one tile takes
+#define TILE_STORE_STALE_SECONDS 5.0
+
+typedef struct {
+    // even and non-zero when the slot holds a tile, odd while being written
+    _Atomic uint32_t sequence;
+    int32_t level;
+    int32_t depth;
+    int32_t formula;
+    int32_t precision;
+    int32_t pad;
+    int64_t tx;
+    int64_t ty;
+    _Atomic uint64_t lastUse;
+    // platformTime() in microseconds when the last writer started, set before
+    // it makes the sequence odd
+    _Atomic uint64_t writeStart;
+} TileStoreSlot;
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t tileSize;
+    uint32_t slotCount;
+    // 0 for a new file, 1 while the creating process fills this in, 2 ready;
+    // the creator holds the file lock until then
+    _Atomic uint32_t state;
+    uint32_t pad;
+    // bumped on every store and hit, the age of a slot's last use
+    _Atomic uint64_t clock;
+    // lookups over every run and process since the file was created
+    _Atomic uint64_t hits;
+    _Atomic uint64_t misses;
+} TileStoreHeader;
+
+typedef struct {
+    MappedFile file;
+    TileStoreHeader* header;
+    TileStoreSlot* slots;
+    unsigned char* data;
+    uint32_t slotCount;
+    // this process only
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long stored;
+    // tiles that were rewritten by another process while in use
+    unsigned long long raced;
+} TileStore;
+
+// a tile read from the mapping, valid while tileStillValid says so
+typedef struct {
+    const int* iters;
+    uint32_t slot;
+    uint32_t sequence;
+} StoredTile;
+
+// opens path, creating it with room for about sizeMb of tiles if it does not
+// exist (an existing file keeps its size); returns 0 if the file cannot be
+// mapped or was written by an incompatible version
+int openTileStore(TileStore* store, const char* path, double sizeMb);
+// zero-copy lookup, returns 0 on a miss
+int findStoredTile(TileStore* store, const TileKey* key, StoredTile* out);
+// whether a tile returned by findStoredTile was not overwritten since
+int tileStillValid(TileStore* store, const StoredTile* tile);
+// copies iters into the store; skipped when every slot of the set is being
+// written by another process at that moment, or when a writer that stalled
+// for TILE_STORE_STALE_SECONDS finds its slot was taken over
+void storeTile(TileStore* store, const TileKey* key, const int* iters);
+void closeTileStore(TileStore* store);
+void printTileStore(const TileStore* store);
+
+#endif
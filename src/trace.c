@@ -0,0 +1,141 @@
+#include "trace.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "platform.h"
+
+typedef struct {
+    const char* name;
+    int tid;
+    double start;
+    double end;
+} TraceEvent;
+
+typedef struct TraceBuffer {
+    struct TraceBuffer* next;
+    // on the free list while no thread owns it
+    struct TraceBuffer* nextFree;
+    const char* threadName;
+    int tid;
+    atomic_int count;
+    int dropped;
+    TraceEvent events[TRACE_EVENTS_PER_THREAD];
+} TraceBuffer;
+
+static atomic_int enabled;
+static double traceStart;
+static atomic_int nextTid = TRACE_GPU_TID + 1;
+static _Atomic(TraceBuffer*) buffers;
+static _Thread_local TraceBuffer* threadBuffer;
+// buffers of threads that exited, and the key whose destructor puts them there
+static pthread_mutex_t freeLock = PTHREAD_MUTEX_INITIALIZER;
+static TraceBuffer* freeBuffers;
+static pthread_once_t keyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t bufferKey;
+
+static void retireBuffer(void* arg) {
+    TraceBuffer* b = arg;
+    pthread_mutex_lock(&freeLock);
+    b->nextFree = freeBuffers;
+    freeBuffers = b;
+    pthread_mutex_unlock(&freeLock);
+}
+
+static void createBufferKey(void) {
+    pthread_key_create(&bufferKey, retireBuffer);
+}
+
+void traceEnable(void) {
+    traceStart = platformTime();
+    atomic_store(&enabled, 1);
+}
+
+int traceEnabled(void) {
+    return atomic_load_explicit(&enabled, memory_order_relaxed);
+}
+
+// first event on a thread takes a retired buffer, or allocates one and pushes
+// it on the list
+static TraceBuffer* getThreadBuffer(void) {
+    if (threadBuffer) return threadBuffer;
+    pthread_once(&keyOnce, createBufferKey);
+    pthread_mutex_lock(&freeLock);
+    TraceBuffer* b = freeBuffers;
+    if (b) freeBuffers = b->nextFree;
+    pthread_mutex_unlock(&freeLock);
+    if (!b) {
+        b = calloc(1, sizeof(TraceBuffer));
+        if (!b) return NULL;
+        b->tid = atomic_fetch_add(&nextTid, 1);
+        b->next = atomic_load(&buffers);
+        while (!atomic_compare_exchange_weak(&buffers, &b->next, b)) {}
+    }
+    pthread_setspecific(bufferKey, b);
+    threadBuffer = b;
+    return b;
+}
+
+void traceThreadName(const char* name) {
+    if (!traceEnabled()) return;
+    TraceBuffer* b = getThreadBuffer();
+    if (b) b->threadName = name;
+}
+
+double traceBegin(void) {
+    return traceEnabled() ? platformTime() : 0.0;
+}
+
+void traceComplete(const char* name, int tid, double start, double end) {
+    if (!traceEnabled()) return;
+    TraceBuffer* b = getThreadBuffer();
+    if (!b) return;
+    int n = atomic_load_explicit(&b->count, memory_order_relaxed);
+    if (n == TRACE_EVENTS_PER_THREAD) {
+        b->dropped++;
+        return;
+    }
+    b->events[n] = (TraceEvent){name, tid, start, end};
+    atomic_store_explicit(&b->count, n + 1, memory_order_release);
+}
+
+void traceEnd(const char* name, double start) {
+    if (start == 0.0 || !traceEnabled()) return;
+    TraceBuffer* b = getThreadBuffer();
+    if (!b) return;
+    traceComplete(name, b->tid, start, platformTime());
+}
+
+static void writeThreadName(FILE* fp, int* first, int tid, const char* name) {
+    fprintf(fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            *first ? "" : ",", tid, name);
+    *first = 0;
+}
+
+int writeTrace(const char* path) {
+    FILE* fp = fopen(path, "w");
+    if (!fp) return 0;
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    int first = 1;
+    int dropped = 0;
+    writeThreadName(fp, &first, TRACE_GPU_TID, "GPU");
+    for (TraceBuffer* b = atomic_load(&buffers); b; b = b->next) {
+        char fallback[32];
+        snprintf(fallback, sizeof(fallback), "thread %d", b->tid);
+        writeThreadName(fp, &first, b->tid, b->threadName ? b->threadName : fallback);
+
+        int count = atomic_load_explicit(&b->count, memory_order_acquire);
+        for (int i = 0; i < count; i++) {
+            const TraceEvent* e = &b->events[i];
+            fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    e->name, e->tid, (e->start - traceStart) * 1e6, (e->end - e->start) * 1e6);
+        }
+        dropped += b->dropped;
+    }
+    fprintf(fp, "\n]}\n");
+    if (dropped) fprintf(stderr, "trace: %d events dropped, buffers full\n", dropped);
+    return fclose(fp) == 0;
+}
@@ -0,0 +1,30 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Chrome trace / Perfetto export of scoped events. Every thread records into
+// its own buffer, so recording takes no lock; buffers are only read by
+// writeTrace. The buffer of a thread that exits goes to the next thread
+// started, track and events included, so short-lived workers do not each
+// keep one. Event names must be string literals, only the pointer is kept.
+
+#define TRACE_PATH "trace.json"
+#define TRACE_EVENTS_PER_THREAD 65536
+// track the GPU timer query results are shown on
+#define TRACE_GPU_TID 0
+
+void traceEnable(void);
+int traceEnabled(void);
+
+// names the calling thread's track
+void traceThreadName(const char* name);
+
+// returns the start time to pass to traceEnd, 0 when tracing is off
+double traceBegin(void);
+void traceEnd(const char* name, double start);
+// records an event with explicit times (platformTime seconds) on track tid
+void traceComplete(const char* name, int tid, double start, double end);
+
+// writes every buffer as a trace file, returns 0 on failure
+int writeTrace(const char* path);
+
+#endif
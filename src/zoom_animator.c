@@ -0,0 +1,89 @@
+#include "zoom_animator.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// close enough to snap to the target
+#define ARRIVED_LOG_SCALE 1e-3
+#define ARRIVED_OFFSET 1e-3
+
+void initZoomAnimator(ZoomAnimator* z) {
+    memset(z, 0, sizeof(*z));
+}
+
+void animateZoom(ZoomAnimator* z, const double section[4], double u, double v, double factor) {
+    if (!z->active) {
+        memcpy(z->section, section, sizeof(z->section));
+        memcpy(z->target, section, sizeof(z->target));
+        z->active = 1;
+    }
+    // the point under the cursor now is where the target zooms around
+    double x = section[0] + u*(section[2] - section[0]);
+    double y = section[1] + v*(section[3] - section[1]);
+    z->target[0] = x + (z->target[0] - x)/factor;
+    z->target[1] = y + (z->target[1] - y)/factor;
+    z->target[2] = x + (z->target[2] - x)/factor;
+    z->target[3] = y + (z->target[3] - y)/factor;
+}
+
+// one axis, lo and hi of the shown section, toward target; 1 once there
+static int stepAxis(double* lo, double* hi, double targetLo, double targetHi, double amount) {
+    double width = *hi - *lo;
+    double targetWidth = targetHi - targetLo;
+    double centre = 0.5*(*lo + *hi);
+    double targetCentre = 0.5*(targetLo + targetHi);
+    double ratio = targetWidth/width;
+    if (fabs(log(ratio)) < ARRIVED_LOG_SCALE && fabs(targetCentre - centre) < ARRIVED_OFFSET*fabs(targetWidth)) {
+        return 1;
+    }
+    // scaling by ratio^amount around the fixed point moves the centre this
+    // share of the way, amount itself when the width does not change
+    double scale = pow(ratio, amount);
+    double share = fabs(1.0 - ratio) < 1e-9 ? amount : (1.0 - scale)/(1.0 - ratio);
+    centre += (targetCentre - centre)*share;
+    width *= scale;
+    *lo = centre - 0.5*width;
+    *hi = centre + 0.5*width;
+    return 0;
+}
+
+int stepZoomAnimator(ZoomAnimator* z, double dt, double out[4]) {
+    double amount = 1.0 - exp(-fmin(dt, ZOOM_MAX_STEP_SECONDS)/ZOOM_TIME_CONSTANT);
+    int arrivedX = stepAxis(&z->section[0], &z->section[2], z->target[0], z->target[2], amount);
+    int arrivedY = stepAxis(&z->section[1], &z->section[3], z->target[1], z->target[3], amount);
+    if (arrivedX && arrivedY) {
+        memcpy(z->section, z->target, sizeof(z->section));
+        z->active = 0;
+    }
+    memcpy(out, z->section, sizeof(z->section));
+    return z->active;
+}
+
+void stopZoomAnimator(ZoomAnimator* z) {
+    z->active = 0;
+}
+
+void countAnimatedFrame(ZoomAnimator* z, double share) {
+    z->frames++;
+    if (share > 0.0) z->reusingFrames++;
+    z->reusedShare += share;
+}
+
+void printZoomAnimator(const ZoomAnimator* z) {
+    printf("zoom animation: %llu frames, %llu reused an earlier frame, %.1f%% of their pixels on average\n",
+           z->frames, z->reusingFrames, z->reusingFrames ? 100.0*z->reusedShare/z->reusingFrames : 0.0);
+}
+
+static double reusableAxis(double referenceLo, double referenceHi, double lo, double hi) {
+    double width = fabs(hi - lo);
+    double overlap = fmin(fmax(referenceLo, referenceHi), fmax(lo, hi)) -
+                     fmax(fmin(referenceLo, referenceHi), fmin(lo, hi));
+    if (overlap <= 0.0 || width <= 0.0) return 0.0;
+    return overlap/width * fmin(1.0, width/fabs(referenceHi - referenceLo));
+}
+
+double reusableShare(const double reference[4], const double section[4]) {
+    return reusableAxis(reference[0], reference[2], section[0], section[2]) *
+           reusableAxis(reference[1], reference[3], section[1], section[3]);
+}
@@ -0,0 +1,45 @@
+#ifndef ZOOM_ANIMATOR_H
+#define ZOOM_ANIMATOR_H
+
+// Zooms that glide instead of jumping. Each wheel notch moves the target
+// section, and every frame the shown section covers a fixed share of what
+// is left, in log scale around the point that maps the one onto the other,
+// so the point under the cursor stays put. Frames in between are rendered
+// by reusing an earlier full frame, see reusableShare.
+
+#define ZOOM_WHEEL_STEP 1.25
+// seconds in which about two thirds of the remaining zoom is covered
+#define ZOOM_TIME_CONSTANT 0.08
+// a longer frame (the first after an idle wait) counts as this long
+#define ZOOM_MAX_STEP_SECONDS (1.0/30.0)
+// below this share of reusable pixels a frame is rendered in full instead,
+// and becomes the new reference
+#define REUSE_MIN_SHARE 0.5
+
+typedef struct {
+    // A and B, UVs of the home view
+    double section[4];
+    double target[4];
+    int active;
+    unsigned long long frames;
+    unsigned long long reusingFrames;
+    double reusedShare;
+} ZoomAnimator;
+
+void initZoomAnimator(ZoomAnimator* z);
+// zooms the target by factor around the point at (u, v) of the window, which
+// shows section; starts from section unless an animation is under way
+void animateZoom(ZoomAnimator* z, const double section[4], double u, double v, double factor);
+// moves dt seconds on into out, returns 0 on the frame that arrives
+int stepZoomAnimator(ZoomAnimator* z, double dt, double out[4]);
+void stopZoomAnimator(ZoomAnimator* z);
+// counts an animated frame that reused share of its pixels
+void countAnimatedFrame(ZoomAnimator* z, double share);
+void printZoomAnimator(const ZoomAnimator* z);
+
+// the share of the pixels of a frame of section that have a sample of a frame
+// of reference (same size) within half a pixel: the overlap, times the
+// reference's sample density where it is sparser than the frame's
+double reusableShare(const double reference[4], const double section[4]);
+
+#endif
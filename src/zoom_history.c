@@ -0,0 +1,172 @@
+#include "zoom_history.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// PackBits on whole pixels: a control byte below 128 is followed by that
+// many plus one literal pixels, one of 128 and up by a pixel repeated
+// control - 126 times. Interior and palette bands are long runs.
+#define LITERAL_MAX 128
+#define RUN_MAX 129
+
+static uint32_t pixelAt(const unsigned char* rgba, size_t i) {
+    uint32_t p;
+    memcpy(&p, rgba + i*4, 4);
+    return p;
+}
+
+static size_t packPixels(const unsigned char* rgba, size_t count, unsigned char* out) {
+    size_t used = 0;
+    size_t i = 0;
+    while (i < count) {
+        uint32_t p = pixelAt(rgba, i);
+        size_t run = 1;
+        while (i + run < count && run < RUN_MAX && pixelAt(rgba, i + run) == p) run++;
+        if (run >= 2) {
+            out[used++] = (unsigned char)(run + 126);
+            memcpy(out + used, &p, 4);
+            used += 4;
+            i += run;
+            continue;
+        }
+        // literals up to where the next run starts
+        size_t start = i;
+        size_t length = 0;
+        while (i < count && length < LITERAL_MAX &&
+               !(i + 1 < count && pixelAt(rgba, i + 1) == pixelAt(rgba, i))) {
+            i++;
+            length++;
+        }
+        out[used++] = (unsigned char)(length - 1);
+        memcpy(out + used, rgba + start*4, length*4);
+        used += length*4;
+    }
+    return used;
+}
+
+static int unpackPixels(const unsigned char* packed, size_t packedBytes,
+                        unsigned char* rgba, size_t count) {
+    size_t in = 0;
+    size_t i = 0;
+    while (in < packedBytes && i < count) {
+        unsigned control = packed[in++];
+        if (control < 128) {
+            size_t length = control + 1;
+            if (i + length > count || in + length*4 > packedBytes) return 0;
+            memcpy(rgba + i*4, packed + in, length*4);
+            in += length*4;
+            i += length;
+        } else {
+            size_t run = control - 126;
+            if (i + run > count || in + 4 > packedBytes) return 0;
+            for (size_t k = 0; k < run; k++) memcpy(rgba + (i + k)*4, packed + in, 4);
+            in += 4;
+            i += run;
+        }
+    }
+    return i == count;
+}
+
+static void dropImage(ZoomHistory* h, HistoryEntry* e) {
+    h->packedBytes -= e->packedBytes;
+    free(e->packed);
+    e->packed = NULL;
+    e->packedBytes = 0;
+}
+
+static void setEntry(HistoryEntry* e, const double section[4]) {
+    memset(e, 0, sizeof(*e));
+    memcpy(e->section, section, sizeof(e->section));
+}
+
+void initZoomHistory(ZoomHistory* h, const double home[4], size_t budget) {
+    memset(h, 0, sizeof(*h));
+    h->budget = budget;
+    setEntry(&h->entries[0], home);
+    h->count = 1;
+}
+
+void pushZoomView(ZoomHistory* h, const double section[4]) {
+    for (int i = h->current + 1; i < h->count; i++) dropImage(h, &h->entries[i]);
+    h->count = h->current + 1;
+    if (h->count == ZOOM_HISTORY_MAX) {
+        dropImage(h, &h->entries[0]);
+        memmove(&h->entries[0], &h->entries[1], (ZOOM_HISTORY_MAX - 1) * sizeof(HistoryEntry));
+        h->count--;
+    }
+    setEntry(&h->entries[h->count], section);
+    h->current = h->count++;
+}
+
+const HistoryEntry* zoomBack(ZoomHistory* h) {
+    if (h->current == 0) return NULL;
+    return &h->entries[--h->current];
+}
+
+const HistoryEntry* zoomForward(ZoomHistory* h) {
+    if (h->current + 1 >= h->count) return NULL;
+    return &h->entries[++h->current];
+}
+
+int hasHistoryImage(const ZoomHistory* h, const void* key, size_t keySize) {
+    const HistoryEntry* e = &h->entries[h->current];
+    return e->packed && e->keySize == keySize && memcmp(e->key, key, keySize) == 0;
+}
+
+void storeHistoryImage(ZoomHistory* h, const void* key, size_t keySize,
+                       int width, int height, const unsigned char* rgba) {
+    if (keySize > ZOOM_HISTORY_KEY_MAX) return;
+    HistoryEntry* e = &h->entries[h->current];
+    dropImage(h, e);
+    size_t pixels = (size_t)width * height;
+    // all literals is the worst case
+    unsigned char* packed = malloc(pixels*4 + (pixels + LITERAL_MAX - 1)/LITERAL_MAX);
+    if (!packed) return;
+    size_t used = packPixels(rgba, pixels, packed);
+    unsigned char* shrunk = realloc(packed, used);
+    e->packed = shrunk ? shrunk : packed;
+    e->packedBytes = used;
+    memcpy(e->key, key, keySize);
+    e->keySize = keySize;
+    e->width = width;
+    e->height = height;
+    h->packedBytes += used;
+
+    // oldest images go first, the one just stored stays
+    for (int i = 0; i < h->count && h->packedBytes > h->budget; i++) {
+        if (i != h->current) dropImage(h, &h->entries[i]);
+    }
+}
+
+int restoreHistoryImage(ZoomHistory* h, const void* key, size_t keySize,
+                        int width, int height, unsigned char* rgba) {
+    const HistoryEntry* e = &h->entries[h->current];
+    if (!hasHistoryImage(h, key, keySize) || e->width != width || e->height != height) return 0;
+    if (!unpackPixels(e->packed, e->packedBytes, rgba, (size_t)width * height)) return 0;
+    h->restored++;
+    return 1;
+}
+
+void dropHistoryImages(ZoomHistory* h) {
+    for (int i = 0; i < h->count; i++) dropImage(h, &h->entries[i]);
+}
+
+void destroyZoomHistory(ZoomHistory* h) {
+    for (int i = 0; i < h->count; i++) free(h->entries[i].packed);
+    memset(h, 0, sizeof(*h));
+}
+
+void printZoomHistory(const ZoomHistory* h) {
+    int images = 0;
+    double rawBytes = 0.0;
+    for (int i = 0; i < h->count; i++) {
+        if (!h->entries[i].packed) continue;
+        images++;
+        rawBytes += 4.0 * h->entries[i].width * h->entries[i].height;
+    }
+    printf("zoom history: %d views, %d images in %.1f MB (%.1fx packed), %llu restored without rendering\n",
+           h->count, images, (double)h->packedBytes/(1024.0*1024.0),
+           h->packedBytes ? rawBytes/h->packedBytes : 0.0, h->restored);
+}
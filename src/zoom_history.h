@@ -0,0 +1,61 @@
+#ifndef ZOOM_HISTORY_H
+#define ZOOM_HISTORY_H
+
+#include <stddef.h>
+
+// Back/forward list of the views zoomed through, like a browser's. Each view
+// keeps the image it converged to, run-length packed, so that going back to
+// it is an upload instead of a render. The image is only used again if the
+// key it was stored under (whatever else the pixels depend on: depth, colour,
+// size, ...) still matches. Once the packed images exceed the budget the
+// oldest ones are dropped; their views stay in the list and render again.
+
+#define ZOOM_HISTORY_MAX 64
+#define ZOOM_HISTORY_KEY_MAX 128
+#define ZOOM_HISTORY_BUDGET (64u << 20)
+
+typedef struct {
+    // A and B, UVs of the home view
+    double section[4];
+    unsigned char key[ZOOM_HISTORY_KEY_MAX];
+    size_t keySize;
+    int width;
+    int height;
+    unsigned char* packed;
+    size_t packedBytes;
+} HistoryEntry;
+
+typedef struct {
+    HistoryEntry entries[ZOOM_HISTORY_MAX];
+    int count;
+    int current;
+    size_t packedBytes;
+    size_t budget;
+    unsigned long long restored;
+} ZoomHistory;
+
+// starts with the home view as the only entry
+void initZoomHistory(ZoomHistory* h, const double home[4], size_t budget);
+// makes section the current view, dropping everything forward of the
+// current one; the oldest view goes when the list is full
+void pushZoomView(ZoomHistory* h, const double section[4]);
+// moves one view back or forward, returns NULL at either end
+const HistoryEntry* zoomBack(ZoomHistory* h);
+const HistoryEntry* zoomForward(ZoomHistory* h);
+
+// whether the current view holds an image stored under key
+int hasHistoryImage(const ZoomHistory* h, const void* key, size_t keySize);
+// packs a width x height RGBA8 image into the current view
+void storeHistoryImage(ZoomHistory* h, const void* key, size_t keySize,
+                       int width, int height, const unsigned char* rgba);
+// unpacks the current view's image into rgba if it was stored under key at
+// that size, returns 0 otherwise
+int restoreHistoryImage(ZoomHistory* h, const void* key, size_t keySize,
+                        int width, int height, unsigned char* rgba);
+// drops every stored image, the views stay; for when the kernel that
+// rendered them changes, which no key covers
+void dropHistoryImages(ZoomHistory* h);
+void destroyZoomHistory(ZoomHistory* h);
+void printZoomHistory(const ZoomHistory* h);
+
+#endif
@@ -0,0 +1,77 @@
+// Build step that turns GLSL files into C string constants, so the binary
+// does not need the shader directory at runtime.
+//
+//   embed_shaders out.c shader/a.glsl shader/b.glsl ...
+//
+// Each file becomes an entry of EMBEDDED_SHADERS named by its file name,
+// looked up through embeddedShader() in src/embedded_shaders.h.
+
+#include <stdio.h>
+#include <string.h>
+
+static const char* baseName(const char* path) {
+    const char* name = path;
+    for (const char* p = path; *p; p++) {
+        if (*p == '/' || *p == '\\') name = p + 1;
+    }
+    return name;
+}
+
+// one string literal per source line, so the generated file diffs and reads like the shader
+static int embedFile(FILE* out, const char* path) {
+    FILE* in = fopen(path, "rb");
+    if (!in) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return 0;
+    }
+    fprintf(out, "    {\"%s\",\n        \"", baseName(path));
+    int c;
+    while ((c = fgetc(in)) != EOF) {
+        switch (c) {
+            case '\r': break;
+            case '\n':
+                fputs("\\n\"\n        \"", out);
+                break;
+            case '\\': fputs("\\\\", out); break;
+            case '"': fputs("\\\"", out); break;
+            case '\t': fputs("\\t", out); break;
+            default:
+                if (c < 0x20 || c >= 0x7F) fprintf(out, "\\%03o", c);
+                else fputc(c, out);
+                break;
+        }
+    }
+    fputs("\"},\n", out);
+    int ok = !ferror(in);
+    fclose(in);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: embed_shaders out.c file...\n");
+        return -1;
+    }
+    FILE* out = fopen(argv[1], "wb");
+    if (!out) {
+        fprintf(stderr, "Failed to open %s\n", argv[1]);
+        return -1;
+    }
+    fprintf(out, "// generated by tools/embed_shaders.c, do not edit\n\n");
+    fprintf(out, "#include \"embedded_shaders.h\"\n\n");
+    fprintf(out, "#include <string.h>\n\n");
+    fprintf(out, "static const EmbeddedShader EMBEDDED_SHADERS[] = {\n");
+    int ok = 1;
+    for (int i = 2; i < argc && ok; i++) ok = embedFile(out, argv[i]);
+    fprintf(out, "};\n\n");
+    fprintf(out,
+        "const char* embeddedShader(const char* name) {\n"
+        "    for (size_t i = 0; i < sizeof(EMBEDDED_SHADERS) / sizeof(EMBEDDED_SHADERS[0]); i++) {\n"
+        "        if (strcmp(EMBEDDED_SHADERS[i].name, name) == 0) return EMBEDDED_SHADERS[i].source;\n"
+        "    }\n"
+        "    return NULL;\n"
+        "}\n");
+    if (fclose(out) != 0) ok = 0;
+    if (!ok) remove(argv[1]);
+    return ok ? 0 : 1;
+}